@@ -0,0 +1,273 @@
+// Headless rendering benchmark. Renders the game into an offscreen
+// framebuffer through an EGL context without a window, so it runs on CI
+// machines and with Mesa's software rasterizer (EGL_PLATFORM=surfaceless,
+// LIBGL_ALWAYS_SOFTWARE=1). A fixed-seed input script drives the player and
+// the camera follows a scripted path around it; every frame advances the
+// simulation by 1/60 s regardless of how long it took, so runs are
+// reproducible. Reports average and percentile frame times (CPU submission
+// up to glFinish) and optionally writes frames as PNG images.
+//
+// --threaded runs the simulation on its own thread in real time, as the game
+// does, with the script posted as input events; frames then only draw the
+// latest snapshot, and the tick rate shows whether slow frames held it up.
+//
+// usage: IcyHotRenderBench [--level <file>] [--size <width>x<height>]
+//                          [--warmup <frames>] [--capture <prefix>]
+//                          [--capture-every <frames>] [--profile <file>]
+//                          [--threaded] [frames]
+
+#include <glad/glad.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <Framebuffer.hpp>
+#include <InputRecording.hpp>
+#include <Profiler.hpp>
+#include <Scene.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace {
+
+const float FRAME_TIME = 1.0f / 60.0f;
+
+// Mesa's surfaceless platform needs neither a display server nor a GPU;
+// other drivers fall back to their default display
+EGLDisplay openDisplay() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+            EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+            return display;
+    }
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+        return display;
+    return EGL_NO_DISPLAY;
+}
+
+// desktop GL 3.3 core without any surface; everything is drawn into a
+// Framebuffer, which needs EGL_KHR_surfaceless_context
+EGLContext createContext(EGLDisplay display) {
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, 0,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configs = 0;
+    if (!eglBindAPI(EGL_OPENGL_API) ||
+        !eglChooseConfig(display, configAttributes, &config, 1, &configs) || configs == 0)
+        return EGL_NO_CONTEXT;
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT)
+        return EGL_NO_CONTEXT;
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        eglDestroyContext(display, context);
+        return EGL_NO_CONTEXT;
+    }
+    return context;
+}
+
+// the camera sways around the player and drifts in and out, so culling and
+// streaming see a moving frustum
+void cameraPath(const glm::vec3& target, float time, glm::vec3& eye, glm::mat4& view) {
+    eye = target + glm::vec3(4.0f * std::sin(time * 0.5f),
+        2.0f + std::cos(time * 0.3f), 15.0f + 3.0f * std::sin(time * 0.2f));
+    view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+std::string captureName(const std::string& prefix, unsigned int frame) {
+    char number[16];
+    std::snprintf(number, sizeof(number), "%05u", frame);
+    return prefix + number + ".png";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string levelPath = PROJECT_SOURCE_DIR "/res/levels/cave.lvl";
+    std::string capturePrefix;
+    std::string profilePath;
+    unsigned int captureEvery = 60;
+    unsigned int warmup = 30;
+    bool threaded = false;
+    unsigned int frames = 600;
+    int width = 1280;
+    int height = 720;
+    for (int i = 1; i < argc; i++) {
+        std::string argument(argv[i]);
+        if (argument == "--level" && i + 1 < argc)
+            levelPath = argv[++i];
+        else if (argument == "--size" && i + 1 < argc)
+            std::sscanf(argv[++i], "%dx%d", &width, &height);
+        else if (argument == "--warmup" && i + 1 < argc)
+            warmup = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (argument == "--capture" && i + 1 < argc)
+            capturePrefix = argv[++i];
+        else if (argument == "--capture-every" && i + 1 < argc)
+            captureEvery = static_cast<unsigned int>(
+                std::max(1ul, std::strtoul(argv[++i], nullptr, 10)));
+        else if (argument == "--profile" && i + 1 < argc)
+            profilePath = argv[++i];
+        else if (argument == "--threaded")
+            threaded = true;
+        else
+            frames = static_cast<unsigned int>(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (frames == 0 || width <= 0 || height <= 0)
+        return 1;
+
+    EGLDisplay display = openDisplay();
+    if (display == EGL_NO_DISPLAY) {
+        std::cout << "ERROR::EGL::NO_DISPLAY" << std::endl;
+        return 1;
+    }
+    EGLContext context = createContext(display);
+    if (context == EGL_NO_CONTEXT) {
+        std::cout << "ERROR::EGL::CONTEXT_NOT_CREATED 0x" << std::hex << eglGetError()
+            << std::dec << std::endl;
+        eglTerminate(display);
+        return 1;
+    }
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress))) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return 1;
+    }
+    std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+    int status = 0;
+    {
+        glEnable(GL_DEPTH_TEST);
+        Framebuffer target(width, height);
+        Profiler profiler;
+        profiler.setEnabled(!profilePath.empty());
+        Scene scene(PROJECT_SOURCE_DIR "/res/", profiler);
+        if (!target.complete() || !scene.loadLevel(levelPath)) {
+            status = 1;
+        } else {
+            target.bind();
+            glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+                static_cast<float>(width) / static_cast<float>(height), 0.1f, 100.0f);
+            std::vector<TickInput> inputs = scriptedInput(warmup + frames);
+            std::vector<double> frameTimes;
+            frameTimes.reserve(frames);
+            unsigned long long drawCalls = 0;
+            unsigned long long triangles = 0;
+            unsigned long long lights = 0;
+            unsigned int maxCellLights = 0;
+
+            // the measured frames' ticks, to time the simulation thread
+            unsigned long long firstTick = 0;
+            double firstClock = 0.0;
+            if (threaded)
+                scene.startSimulation(nullptr);
+
+            for (unsigned int frame = 0; frame < warmup + frames; frame++) {
+                std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+                profiler.beginFrame();
+
+                TickInput input = inputs[frame];
+                if (threaded) {
+                    InputEvent event = { scene.simulationClock(), input.x, input.events };
+                    scene.post(event);
+                    scene.sync();
+                } else {
+                    scene.update(FRAME_TIME, input, nullptr);
+                }
+                if (frame == warmup) {
+                    firstTick = scene.snapshot().tick;
+                    firstClock = scene.simulationClock();
+                }
+
+                const WorldSnapshot& world = scene.snapshot();
+                float time = frame * FRAME_TIME;
+                glm::vec3 eye;
+                glm::mat4 view;
+                cameraPath(world.playerStart + world.move, time, eye, view);
+                scene.render(projection, view, eye, time);
+
+                // the frame counts as done once the GPU (or rasterizer) is idle
+                profiler.beginScope("finish");
+                glFinish();
+                profiler.endScope();
+                profiler.endFrame();
+                std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+                if (frame < warmup)
+                    continue;
+                unsigned int measured = frame - warmup;
+                frameTimes.push_back(
+                    std::chrono::duration<double, std::milli>(end - begin).count());
+                drawCalls += scene.blocks().drawCalls();
+                triangles += scene.blocks().triangles();
+                lights += scene.lights().visibleLights();
+                maxCellLights = std::max(maxCellLights, scene.lights().maxCellLights());
+                if (!capturePrefix.empty() && measured % captureEvery == 0)
+                    target.capture(captureName(capturePrefix, measured));
+            }
+
+            unsigned long long ticks = scene.snapshot().tick - firstTick;
+            double clock = scene.simulationClock() - firstClock;
+            scene.stopSimulation();
+
+            double total = 0.0;
+            for (size_t i = 0; i < frameTimes.size(); i++)
+                total += frameTimes[i];
+            double average = total / frameTimes.size();
+            std::sort(frameTimes.begin(), frameTimes.end());
+            std::cout << levelPath << ": " << frames << " frames at " << width << "x"
+                << height << ", avg " << average << " ms (" << 1000.0 / average
+                << " fps), p50 " << percentile(frameTimes, 0.50) << " ms, p95 "
+                << percentile(frameTimes, 0.95) << " ms, p99 "
+                << percentile(frameTimes, 0.99) << " ms, max " << frameTimes.back()
+                << " ms | " << drawCalls / frames << " draws, " << triangles / frames
+                << " triangles/frame | " << lights / frames << " lights/frame, at most "
+                << maxCellLights << " per cell | " << scene.snapshot().streamingStalls
+                << " streaming stalls";
+            if (threaded)
+                std::cout << " | simulation thread " << ticks / clock << " ticks/s";
+            std::cout << std::endl;
+
+            if (profiler.enabled()) {
+                profiler.report(std::cout);
+                profiler.dumpChromeTrace(profilePath);
+            }
+        }
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+    return status;
+}
@@ -0,0 +1,339 @@
+// Headless replay benchmark for the simulation core. Steps a level with
+// recorded (or scripted) input streams and reports ticks per second and the
+// final state hash of every run, so physics changes can be timed and checked
+// for determinism on machines without a GPU.
+//
+// --actors scatters that many enemies, platforms and projectiles over the
+// empty cells of the level, to time the entity systems under load.
+// --actor-step additionally steps those actors alone, that many ticks per
+// step, and fails if any ends up inside a block.
+// --player-step jumps the player alone across the level and back, switching
+// lava and ice on the way, that many ticks per step, and fails if it ends up
+// inside a block.
+// --walk holds right from the start of the level for that many ticks and
+// fails unless the player ends up in another chunk, e.g. on
+// res/levels/corridor.lvl, which is three chunks wide.
+// --corners checks which block a box over a corner of two is resolved
+// against first.
+//
+// usage: IcyHotSimBench [--level <file>] [--actors <count>] [--actor-step <ticks>]
+//                       [--player-step <ticks>] [--walk <ticks>] [--corners]
+//                       [ticks] [recording ...]
+
+#include <AabbKernel.hpp>
+#include <InputRecording.hpp>
+#include <Level.hpp>
+#include <Simulation.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// fixed-seed placement on cells where the actor's whole box is clear of
+// blocks, so runs with the same count hash the same and no actor starts
+// embedded
+void scatterActors(Level& level, unsigned int count) {
+    int minX = 0, minY = 0, maxX = 0, maxY = 0;
+    for (size_t i = 0; i < level.tiles.size(); i++) {
+        const Tile& tile = level.tiles[i];
+        minX = i == 0 ? tile.x : std::min(minX, tile.x);
+        minY = i == 0 ? tile.y : std::min(minY, tile.y);
+        maxX = i == 0 ? tile.x : std::max(maxX, tile.x);
+        maxY = i == 0 ? tile.y : std::max(maxY, tile.y);
+    }
+    int width = maxX - minX + 1;
+    std::vector<bool> occupied(static_cast<size_t>(width) * (maxY - minY + 1), false);
+    for (size_t i = 0; i < level.tiles.size(); i++)
+        occupied[(level.tiles[i].y - minY) * width + level.tiles[i].x - minX] = true;
+    std::vector<glm::ivec2> empty;
+    for (int y = minY; y <= maxY; y++)
+        for (int x = minX; x <= maxX; x++)
+            if (!occupied[(y - minY) * width + x - minX])
+                empty.push_back(glm::ivec2(x, y));
+    if (empty.empty())
+        return;
+
+    // the kinds' sizes, as spawned
+    EntityStore sizes;
+    for (unsigned int kind = 0; kind < ENTITY_KIND_COUNT; kind++)
+        sizes.spawn(static_cast<Entity_Kind>(kind), glm::vec2(0.0f), glm::vec2(0.0f));
+    TileMap tiles;
+    tiles.build(level.tiles);
+    unsigned char layers = SOLID_LAYER | LAVA_LAYER | ICE_LAYER;
+
+    unsigned int seed = 12345u;
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int kind = i % ENTITY_KIND_COUNT;
+        glm::vec2 half(sizes.halfX[kind] - CONTACT_EPSILON, sizes.halfY[kind] - CONTACT_EPSILON);
+        glm::ivec2 cell;
+        bool fits = false;
+        for (size_t attempt = 0; !fits && attempt < 4 * empty.size(); attempt++) {
+            seed = seed * 1664525u + 1013904223u;
+            cell = empty[(seed >> 8) % empty.size()];
+            int cellX = 0, cellY = 0;
+            fits = !tiles.firstOverlap(glm::vec2(cell) - half, glm::vec2(cell) + half,
+                layers, cellX, cellY);
+        }
+        if (!fits)
+            continue;
+        float speed = 1.0f + static_cast<float>((seed >> 4) % 4);
+        ActorSpawn actor;
+        actor.kind = kind;
+        actor.position[0] = static_cast<float>(cell.x);
+        actor.position[1] = static_cast<float>(cell.y);
+        actor.velocity[0] = (seed & 1) ? speed : -speed;
+        actor.velocity[1] = actor.kind == PROJECTILE && (seed & 2) ? speed : 0.0f;
+        level.actors.push_back(actor);
+    }
+}
+
+void run(const std::string& name, const Level& level,
+    const std::vector<TickInput>& inputs, unsigned long long ticks) {
+    if (inputs.empty())
+        return;
+
+    Simulation simulation(level);
+
+    // the stream loops until the requested tick count is reached
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    size_t next = 0;
+    for (unsigned long long t = 0; t < ticks; t++) {
+        simulation.step(inputs[next]);
+        if (++next == inputs.size())
+            next = 0;
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", simulation.hash());
+    std::cout << name << ": " << ticks << " ticks in " << seconds << " s, "
+        << static_cast<unsigned long long>(ticks / seconds) << " ticks/s, hash "
+        << hash << std::endl;
+}
+
+// actors overlapping a block by more than the contact slack
+size_t embeddedActors(const TileMap& tiles, const EntityStore& actors, unsigned char layers) {
+    size_t embedded = 0;
+    for (size_t i = 0; i < actors.size(); i++) {
+        glm::vec2 inset(actors.halfX[i] - CONTACT_EPSILON, actors.halfY[i] - CONTACT_EPSILON);
+        glm::vec2 center(actors.x[i], actors.y[i]);
+        int cellX = 0, cellY = 0;
+        embedded += tiles.firstOverlap(center - inset, center + inset, layers, cellX, cellY);
+    }
+    return embedded;
+}
+
+// the actors without the player, ticks simulated stride ticks per step; swept
+// movement keeps them out of the blocks however long the step is, so this
+// fails if any ends up inside one
+bool runActors(const Level& level, unsigned long long ticks, unsigned int stride) {
+    TileMap tiles;
+    tiles.build(level.tiles);
+    EntityStore actors;
+    for (size_t i = 0; i < level.actors.size(); i++) {
+        const ActorSpawn& actor = level.actors[i];
+        actors.spawn(static_cast<Entity_Kind>(actor.kind),
+            glm::vec2(actor.position[0], actor.position[1]),
+            glm::vec2(actor.velocity[0], actor.velocity[1]) * FIXED_TIMESTEP);
+    }
+    unsigned char layers = SOLID_LAYER | LAVA_LAYER;
+    size_t spawnedEmbedded = embeddedActors(tiles, actors, layers);
+
+    unsigned long long steps = ticks / stride;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (unsigned long long s = 0; s < steps; s++)
+        actors.step(tiles, layers, stride);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    size_t embedded = embeddedActors(tiles, actors, layers);
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    std::cout << "actors, " << stride << " ticks per step: " << steps * stride << " ticks in "
+        << steps << " steps, " << seconds << " s, "
+        << static_cast<unsigned long long>(steps * stride / seconds) << " ticks/s, "
+        << actors.size() << " alive, " << embedded << " inside blocks (" << spawnedEmbedded
+        << " at spawn)" << std::endl;
+    if (embedded > 0) {
+        std::cout << "ERROR::SIMBENCH::ACTORS_INSIDE_BLOCKS" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// the player without the actors, ticks simulated stride ticks per step,
+// jumping across the level and back, a phase each way, with the lava and
+// ice switched at the start of every third phase so blocks also appear
+// around it. Its movement is swept like the actors', so this fails if it
+// ends a step inside a block
+bool runPlayer(const Level& level, unsigned long long ticks, unsigned int stride) {
+    Level alone = level;
+    alone.actors.clear();
+    Simulation simulation(alone);
+    const unsigned long long PHASE_TICKS = 400;
+    glm::vec2 inset(Simulation::playerScale / 2 - CONTACT_EPSILON);
+
+    unsigned long long steps = ticks / stride;
+    unsigned long long lastPhase = ULLONG_MAX;
+    size_t embedded = 0;
+    float lowest = FLT_MAX, highest = -FLT_MAX;
+    for (unsigned long long s = 0; s < steps; s++) {
+        unsigned long long phase = s * stride / PHASE_TICKS;
+        TickInput input = { static_cast<signed char>(phase % 2 ? -1 : 1), JUMP_EVENT };
+        if (phase != lastPhase && phase % 3 == 0)
+            input.events |= SWITCH_EVENT;
+        lastPhase = phase;
+        simulation.step(input, stride);
+
+        glm::vec2 center = glm::vec2(simulation.playerStart() + simulation.player().move);
+        unsigned char layers =
+            SOLID_LAYER | (simulation.state() == 'L' ? LAVA_LAYER : ICE_LAYER);
+        int cellX = 0, cellY = 0;
+        embedded += simulation.tileMap().firstOverlap(center - inset, center + inset, layers,
+            cellX, cellY);
+        lowest = std::min(lowest, center.x);
+        highest = std::max(highest, center.x);
+    }
+
+    std::cout << "player, " << stride << " ticks per step: " << steps * stride << " ticks in "
+        << steps << " steps, x from " << lowest << " to " << highest << ", " << embedded
+        << " steps inside blocks" << std::endl;
+    if (embedded > 0) {
+        std::cout << "ERROR::SIMBENCH::PLAYER_INSIDE_BLOCKS" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// a box over a corner of two blocks is resolved against the lower one, the
+// left one within a row (see TileMap::firstOverlap); the player bumping
+// into a corner depends on that order
+bool corners() {
+    struct Corner_Case {
+        const char* name;
+        Tile blocks[2];
+        glm::vec2 center;
+        glm::ivec2 expected;
+    };
+    const Corner_Case cases[] = {
+        { "floor seam", { { 0, 0, STONE }, { 1, 0, STONE } }, glm::vec2(0.5f, 0.8f),
+            glm::ivec2(0, 0) },
+        { "diagonal", { { 1, 1, STONE }, { 0, 0, LAVA } }, glm::vec2(0.5f, 0.5f),
+            glm::ivec2(0, 0) },
+        { "wall over floor", { { 0, 1, ICE }, { 1, 0, STONE } }, glm::vec2(0.6f, 0.6f),
+            glm::ivec2(1, 0) }
+    };
+    glm::vec2 half(Simulation::playerScale / 2);
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const Corner_Case& corner = cases[i];
+        TileMap tiles;
+        tiles.build(std::vector<Tile>(corner.blocks, corner.blocks + 2));
+        int cellX = 0, cellY = 0;
+        bool found = tiles.firstOverlap(corner.center - half, corner.center + half,
+            SOLID_LAYER | LAVA_LAYER | ICE_LAYER, cellX, cellY);
+        bool expected = found && glm::ivec2(cellX, cellY) == corner.expected;
+        std::cout << "corner, " << corner.name << ": resolved against (" << cellX << ", "
+            << cellY << ")" << std::endl;
+        if (!expected) {
+            std::cout << "ERROR::SIMBENCH::CORNER_ORDER " << corner.name << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+// chunk column of a cell, counted from the level's first column
+int chunkColumn(const Level& level, float x) {
+    int first = INT_MAX;
+    for (size_t i = 0; i < level.tiles.size(); i++)
+        first = std::min(first, level.tiles[i].x);
+    return static_cast<int>(std::floor((x + 0.5f - first) / TILE_CHUNK_SIZE));
+}
+
+// walks the player right across the level; only the level's wall may stop it
+bool walk(const Level& level, unsigned long long ticks) {
+    Simulation simulation(level);
+    TickInput right = { 1, 0 };
+    for (unsigned long long t = 0; t < ticks; t++)
+        simulation.step(right);
+
+    float from = simulation.playerStart().x;
+    float to = from + simulation.player().move.x;
+    int fromChunk = chunkColumn(level, from);
+    int toChunk = chunkColumn(level, to);
+    std::cout << "walk: " << ticks << " ticks from x " << from << " to " << to
+        << ", chunk column " << fromChunk << " to " << toChunk << std::endl;
+    if (toChunk == fromChunk) {
+        std::cout << "ERROR::SIMBENCH::WALK_STAYED_IN_CHUNK" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string levelPath = PROJECT_SOURCE_DIR "/res/levels/cave.lvl";
+    unsigned int actors = 0;
+    unsigned int actorStep = 0;
+    unsigned int playerStep = 0;
+    unsigned long long walkTicks = 0;
+    bool checkCorners = false;
+    std::vector<std::string> arguments;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--level" && i + 1 < argc)
+            levelPath = argv[++i];
+        else if (std::string(argv[i]) == "--actors" && i + 1 < argc)
+            actors = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::string(argv[i]) == "--actor-step" && i + 1 < argc)
+            actorStep = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::string(argv[i]) == "--player-step" && i + 1 < argc)
+            playerStep = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::string(argv[i]) == "--walk" && i + 1 < argc)
+            walkTicks = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::string(argv[i]) == "--corners")
+            checkCorners = true;
+        else
+            arguments.push_back(argv[i]);
+    }
+
+    unsigned long long ticks = 10000000ULL;
+    if (!arguments.empty())
+        ticks = std::strtoull(arguments[0].c_str(), nullptr, 10);
+
+    Level level;
+    if (!loadLevel(levelPath, level))
+        return 1;
+    if (checkCorners && !corners())
+        return 1;
+    if (walkTicks > 0 && !walk(level, walkTicks))
+        return 1;
+    if (playerStep > 0 && !runPlayer(level, ticks, playerStep))
+        return 1;
+    scatterActors(level, actors);
+    if (actorStep > 0 && !runActors(level, ticks, actorStep))
+        return 1;
+
+    if (arguments.size() <= 1) {
+        run("scripted", level, scriptedInput(100000), ticks);
+        return 0;
+    }
+
+    for (size_t i = 1; i < arguments.size(); i++) {
+        std::vector<TickInput> inputs;
+        if (!loadRecording(arguments[i], inputs))
+            return 1;
+        run(arguments[i], level, inputs, ticks);
+    }
+    return 0;
+}
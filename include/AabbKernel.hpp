@@ -0,0 +1,50 @@
+#ifndef AABB_KERNEL_HPP
+#define AABB_KERNEL_HPP
+
+#include <cstddef>
+
+// What resolveTileContacts did to one box
+enum Tile_Contact {
+    CONTACT_HIT = 1 << 0,   // overlapped its tile and was pushed out
+    CONTACT_GROUND = 1 << 1 // pushed up onto the top of its tile
+};
+
+// Component arrays of count axis aligned boxes, as kept by EntityStore
+struct AabbBatch {
+    size_t count;
+    float* x;
+    float* y;
+    const float* previousY;
+    const float* halfX;
+    const float* halfY;
+    float* velocityX;
+    float* velocityY;
+};
+
+// slack for comparing box edges that were placed exactly against each other
+const float CONTACT_EPSILON = 1e-4f;
+
+// Tests every box against its own candidate unit tile centred at
+// (tileX[i], tileY[i]) and pushes the overlapping ones out. A box that was
+// clear of its tile vertically before the tick lands on it or bumps its head
+// and stops vertically; any other box ran into a wall, is pushed out
+// sideways and turns around. A box without a candidate gets an infinite tile
+// coordinate and is left alone. contacts[i] receives Tile_Contact bits.
+//
+// With ICYHOT_SIMD on, boxes are processed 4 at a time with SSE2, the rest
+// one by one; both paths compute bit-identical results, so the simulation
+// stays deterministic across machines
+// ------------------------------------------------------------------------
+void resolveTileContacts(const AabbBatch& boxes, const float* tileX, const float* tileY,
+    unsigned char* contacts);
+
+// the one-box-at-a-time path, kept callable for comparison
+// ------------------------------------------------------------------------
+void resolveTileContactsScalar(const AabbBatch& boxes, size_t first, const float* tileX,
+    const float* tileY, unsigned char* contacts);
+
+// boxes resolveTileContacts handles per instruction on this CPU
+// ------------------------------------------------------------------------
+unsigned int tileContactLanes();
+
+#endif // AABB_KERNEL_HPP
@@ -0,0 +1,8 @@
+#ifndef BLOCK_HPP
+#define BLOCK_HPP
+
+// Material class of a level block. Every class is rendered as one batch and
+// decides how (and whether) the block takes part in collision
+enum Block_Type { STONE, FINISH, LAVA, ICE, BACKGROUND, PLAYER, BLOCK_TYPE_COUNT };
+
+#endif // BLOCK_HPP
@@ -0,0 +1,134 @@
+#ifndef BLOCK_RENDERER_HPP
+#define BLOCK_RENDERER_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <Block.hpp>
+#include <Entities.hpp>
+#include <Frustum.hpp>
+#include <Mesh.hpp>
+
+#include <memory>
+#include <vector>
+
+// Batched renderer for the level blocks. Per-block model matrices and texture
+// array layers live in a single instance buffer that is only re-uploaded when
+// the level changes, and every material class is submitted with one
+// glDrawElementsInstanced call without rebinding textures
+class BlockRenderer {
+public:
+    // every block is an instance of mesh; textureArray is the
+    // GL_TEXTURE_2D_ARRAY the layers index into. The mesh must outlive the
+    // renderer
+    // ------------------------------------------------------------------------
+    BlockRenderer(const Mesh& mesh, unsigned int textureArray);
+    ~BlockRenderer();
+
+    // level construction; marks the instance buffer dirty
+    // ------------------------------------------------------------------------
+    void clear();
+    void addBlock(Block_Type type, unsigned int layer,
+        const glm::vec3& position, float scale = 1.0f);
+
+    // adds merged geometry of one material within a chunk (see
+    // StaticGeometry), drawn as a single instance translated by position.
+    // The batch owns its mesh, is culled by the mesh bounds and is dropped
+    // again by clear() or by removeChunk with the same chunk id
+    // ------------------------------------------------------------------------
+    void addStaticMesh(Block_Type type, unsigned int layer,
+        const MeshData& data, const glm::vec3& position, int chunk = -1);
+    void removeChunk(int chunk);
+
+    // toggles a whole material class without touching the instance buffer
+    // ------------------------------------------------------------------------
+    void setVisible(Block_Type type, bool visible);
+
+    // the player and the actors are the blocks that move. They share one
+    // dynamic batch at the end of the instance buffer, player first, which is
+    // streamed with a single glBufferSubData per frame and drawn with one
+    // instanced call however many actors there are
+    // ------------------------------------------------------------------------
+    void setPlayer(const glm::mat4& model, unsigned int layer);
+
+    // one instance per actor, alpha of the way from its previous to its
+    // current position and scaled to its box. The layer of an actor is
+    // kindLayers[kind] plus its animation frame (one every 20 ticks) modulo
+    // kindFrames[kind]; both arrays have ENTITY_KIND_COUNT entries
+    // ------------------------------------------------------------------------
+    void setActors(const ActorSnapshot& actors, float alpha,
+        const unsigned int* kindLayers, const unsigned int* kindFrames);
+
+    // true while every instance is a rotation, uniform scale and translation,
+    // so normals can be transformed by the model matrix and the UNIFORM_SCALE
+    // shader variant applies. Level blocks are by construction; the player
+    // and the actors are checked when they are set
+    // ------------------------------------------------------------------------
+    bool uniformScale() const;
+
+    // re-uploads the instance buffer if dirty, binds the texture array to
+    // unit 0 and issues one instanced draw per visible, non-empty batch whose
+    // bounds intersect the frustum. The dynamic batch is never culled
+    // ------------------------------------------------------------------------
+    void draw(const Frustum& frustum);
+
+    // statistics of the last draw: batches submitted and culled by the
+    // frustum (hidden material classes count as neither)
+    // ------------------------------------------------------------------------
+    unsigned int drawCalls() const { return lastDrawCalls; }
+    unsigned int culled() const { return lastCulled; }
+    unsigned int triangles() const { return lastTriangles; }
+
+private:
+    // per-instance vertex data: model matrix at locations 3-6, layer at 7,
+    // normal matrix (inverse transpose, computed once on the CPU) at 8-10
+    struct Instance {
+        glm::mat4 model;
+        float layer;
+        glm::mat3 normal;
+    };
+
+    // batches without their own mesh instance the shared one; the bounds
+    // enclose all instances in world space
+    struct Batch {
+        Block_Type type;
+        unsigned int VAO;
+        unsigned int first;
+        std::vector<Instance> instances;
+        std::shared_ptr<Mesh> mesh;
+        int chunk;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+
+    Batch& findBatch(Block_Type type);
+    void createVertexArray(Batch& batch);
+    const Mesh& meshOf(const Batch& batch) const;
+    static void resetBounds(Batch& batch);
+    void upload();
+    void uploadDynamic();
+    void bindInstanceAttributes(Batch& batch);
+
+    const Mesh* mesh;
+    unsigned int textureArray;
+    unsigned int instanceVBO;
+    unsigned int instanceCapacity;
+    bool dirty;
+    unsigned int lastDrawCalls;
+    unsigned int lastCulled;
+    unsigned int lastTriangles;
+    bool playerUniform;
+    bool actorsUniform;
+    bool dynamicChanged;
+    // instances reserved for the dynamic batch, so actors can come and go
+    // without relaying out the static batches
+    unsigned int dynamicCapacity;
+
+    // the dynamic batch is laid out after all static batches in the instance
+    // buffer: the player at its first instance, then the actors
+    std::vector<Batch> batches;
+    Batch dynamic;
+    bool visible[BLOCK_TYPE_COUNT];
+};
+
+#endif // BLOCK_RENDERER_HPP
@@ -0,0 +1,119 @@
+#ifndef ENTITIES_HPP
+#define ENTITIES_HPP
+
+#include <glm/glm.hpp>
+
+#include <TileMap.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Kinds of dynamic actor besides the player. The kind only picks the
+// defaults an actor spawns with (size, gravity, flags) and its texture;
+// the systems read the per-entity components and never branch on it
+enum Entity_Kind { ENEMY, PLATFORM, PROJECTILE, ENTITY_KIND_COUNT };
+
+enum Entity_Flag {
+    ENTITY_HARMFUL = 1 << 0,     // touching it resets the player
+    ENTITY_CARRIES = 1 << 1,     // the player can stand on it and rides along
+    ENTITY_DIES_ON_HIT = 1 << 2, // removed when it runs into a block
+    ENTITY_GROUNDED = 1 << 3,    // stood on a block after the last step
+    ENTITY_DEAD = 1 << 4         // removed at the end of the tick
+};
+
+// falling actors accelerate like the player: Simulation::gravity per tick
+// on a velocity scaled by Simulation::velocity, in cells per tick squared
+const float ENTITY_GRAVITY = 0.0625f * 0.0625f;
+
+// An actor as authored in a level and stored in its compiled file; the
+// velocity is in cells per second
+struct ActorSpawn {
+    uint32_t kind; // Entity_Kind
+    float position[2];
+    float velocity[2];
+};
+
+// The actors as drawn after a tick: the components the renderer reads,
+// copied out of the store so another thread can draw them
+struct ActorSnapshot {
+    size_t size() const { return x.size(); }
+
+    std::vector<float> x, y;
+    std::vector<float> previousX, previousY;
+    std::vector<float> halfX, halfY;
+    std::vector<unsigned char> kind;
+    std::vector<unsigned short> frame;
+};
+
+// Structure-of-arrays store of every dynamic actor. Each component is its
+// own contiguous array indexed by entity, so a system touches only the
+// components it needs and the loops stay branch free where they can.
+// Entities are removed by moving the last one into their slot, so indices
+// are only stable within a tick
+class EntityStore {
+public:
+    // ------------------------------------------------------------------------
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+    void clear();
+
+    // velocity in cells per tick; the kind picks everything else
+    // ------------------------------------------------------------------------
+    void spawn(Entity_Kind kind, const glm::vec2& position, const glm::vec2& velocity);
+
+    // ticks ticks of every system in one step: move swept against the
+    // active tile layers, resolve what still overlaps, animate, and drop the
+    // dead. Movement is swept, so any number of ticks can be taken at once
+    // without tunnelling. Entities in chunks that are not resident are
+    // frozen, entities that leave the level die
+    // ------------------------------------------------------------------------
+    void step(const TileMap& tiles, unsigned char layers, unsigned int ticks = 1);
+
+    // copies the components the renderer reads, reusing out's buffers
+    // ------------------------------------------------------------------------
+    void snapshot(ActorSnapshot& out) const;
+
+    // whether a harmful entity overlaps the box
+    // ------------------------------------------------------------------------
+    bool touchesHarmful(const glm::vec2& min, const glm::vec2& max) const;
+
+    // a carrying entity whose top the box's bottom edge crossed this tick,
+    // given the box fell by fall while the entity moved; -1 if none
+    // ------------------------------------------------------------------------
+    int support(const glm::vec2& min, const glm::vec2& max, float fall) const;
+
+    // components
+    std::vector<float> x, y;                 // centre
+    std::vector<float> previousX, previousY; // centre before the last step
+    std::vector<float> velocityX, velocityY; // cells per tick
+    std::vector<float> halfX, halfY;         // AABB half extents
+    std::vector<float> gravity;              // cells per tick squared
+    std::vector<unsigned char> kind;         // Entity_Kind
+    std::vector<unsigned char> flags;        // Entity_Flag bits
+    std::vector<unsigned short> frame;       // animation tick
+
+private:
+    void integrate(const TileMap& tiles, unsigned char layers, unsigned int ticks);
+    void collide(const TileMap& tiles, unsigned char layers);
+    void animate(unsigned int ticks);
+    void compact();
+    void applyContact(size_t index, unsigned char contact);
+    void remove(size_t index);
+
+    // collision scratch: the entities left overlapping a block, their
+    // components copied out next to the tile they overlap
+    struct PackedBoxes {
+        void resize(size_t count);
+        void set(size_t slot, const EntityStore& store, unsigned int index,
+            float cellX, float cellY);
+
+        std::vector<unsigned int> entity;
+        std::vector<float> x, y, previousY, halfX, halfY, velocityX, velocityY;
+        std::vector<float> tileX, tileY;
+        std::vector<unsigned char> contacts; // Tile_Contact bits
+    };
+    PackedBoxes packed;
+    std::vector<unsigned int> unresolved;
+};
+
+#endif // ENTITIES_HPP
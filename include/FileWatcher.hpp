@@ -0,0 +1,44 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Reports which of a set of files were rewritten, for hot reload between
+// frames. On Linux the files' directories are watched with inotify, so a
+// poll with nothing changed is a single non-blocking read; elsewhere every
+// watched file's size and modification time are compared
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // changes are reported with the path exactly as passed in here
+    // ------------------------------------------------------------------------
+    void watch(const std::string& path);
+
+    // appends every watched file that was written since the last poll, each
+    // once, and returns whether there were any
+    // ------------------------------------------------------------------------
+    bool poll(std::vector<std::string>& changed);
+
+private:
+    struct Stamp {
+        unsigned long long size;
+        long long modified;
+    };
+
+    // watched path -> last seen stamp (used by the polling fallback)
+    std::map<std::string, Stamp> files;
+#ifdef __linux__
+    int fd;
+    // inotify watch descriptor -> directory as it prefixes the watched paths
+    std::map<int, std::string> directories;
+#endif
+};
+
+#endif // FILE_WATCHER_HPP
@@ -0,0 +1,50 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// Offscreen render target: an RGBA8 colour texture and a 24 bit depth
+// renderbuffer. Used by the headless benchmark, where there is no default
+// framebuffer to draw into, and to capture frames as PNG images
+class Framebuffer {
+public:
+    // prints an error if the driver rejects the attachments
+    // ------------------------------------------------------------------------
+    Framebuffer(int width, int height);
+    ~Framebuffer();
+
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    bool complete() const { return isComplete; }
+
+    // makes this the draw and read framebuffer and sets the viewport to it
+    // ------------------------------------------------------------------------
+    void bind() const;
+
+    // reads the colour attachment back as tightly packed RGBA rows, bottom
+    // row first as GL stores them. Stalls until the frame is finished
+    // ------------------------------------------------------------------------
+    void readPixels(std::vector<unsigned char>& pixels) const;
+
+    // writes the colour attachment to a PNG file, top row first
+    // ------------------------------------------------------------------------
+    bool capture(const std::string& path) const;
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+
+    GLuint ID;
+
+private:
+    GLuint colorTexture;
+    GLuint depthBuffer;
+    int frameWidth;
+    int frameHeight;
+    bool isComplete;
+};
+
+#endif // FRAMEBUFFER_HPP
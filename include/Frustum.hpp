@@ -0,0 +1,26 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+// View frustum as six inward facing planes (ax + by + cz + d >= 0 inside),
+// extracted from a projection * view matrix
+class Frustum {
+public:
+    Frustum();
+
+    // Gribb/Hartmann extraction; the planes are normalized so distances are
+    // in world units
+    // ------------------------------------------------------------------------
+    void extract(const glm::mat4& viewProjection);
+
+    // conservative box test: false only if the box lies completely outside
+    // one of the planes
+    // ------------------------------------------------------------------------
+    bool intersects(const glm::vec3& min, const glm::vec3& max) const;
+
+private:
+    glm::vec4 planes[6];
+};
+
+#endif // FRUSTUM_HPP
@@ -0,0 +1,25 @@
+#ifndef INPUT_RECORDING_HPP
+#define INPUT_RECORDING_HPP
+
+#include <Simulation.hpp>
+
+#include <string>
+#include <vector>
+
+// Text format for per-tick input streams. Each line holds a run of ticks:
+//
+//     <ticks> <x> <events>
+//
+// x is the held direction (-1, 0, 1) for the whole run and events is a
+// combination of J (jump), R (reset) and S (switch) applied on the first tick
+// of the run, or '-' for none. Lines starting with '#' are comments
+// ------------------------------------------------------------------------
+bool saveRecording(const std::string& path, const std::vector<TickInput>& inputs);
+bool loadRecording(const std::string& path, std::vector<TickInput>& inputs);
+
+// deterministic input script: runs, jumps and lava/ice switches from a
+// fixed-seed LCG, so benchmarks without a recording are reproducible too
+// ------------------------------------------------------------------------
+std::vector<TickInput> scriptedInput(size_t ticks, unsigned int seed = 12345u);
+
+#endif // INPUT_RECORDING_HPP
@@ -0,0 +1,130 @@
+#ifndef LEVEL_HPP
+#define LEVEL_HPP
+
+#include <glm/glm.hpp>
+
+#include <Entities.hpp>
+#include <MappedFile.hpp>
+#include <TileMap.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Everything that makes up one level, independent of any rendering state
+struct Level {
+    glm::vec3 playerStart;
+    std::vector<Tile> tiles;
+    // far background planes, drawn behind the level and never collided with
+    std::vector<glm::vec3> backgrounds;
+    // enemies, moving platforms and projectiles present when the level starts
+    std::vector<ActorSpawn> actors;
+};
+
+// Compiled level file, laid out so it can be used straight from a memory
+// mapping:
+//
+//     LevelFileHeader | float backgrounds[backgroundCount][3] |
+//     ActorSpawn actors[actorCount] | uint8 cells[]
+//
+// cells covers the width x height grid in chunks of TILE_CHUNK_SIZE squared
+// cells, chunk rows from originY upwards and the cells of each chunk row by
+// row, so one chunk is a single contiguous read however wide the level is.
+// A cell is 0 when empty and Block_Type + 1 otherwise
+struct LevelFileHeader {
+    char magic[8]; // "ICYLEVEL"
+    uint32_t version;
+    uint32_t backgroundCount;
+    int32_t originX;
+    int32_t originY;
+    uint32_t width;
+    uint32_t height;
+    float playerStart[3];
+    uint32_t actorCount;
+    // FNV-1a of the text source the file was compiled from
+    uint64_t sourceHash;
+};
+
+const uint32_t LEVEL_FILE_VERSION = 4;
+
+// Parses the text authoring format:
+//
+//     # comment
+//     origin <x> <y>             cell of the first character of the first row
+//     background <x> <y> <z>     far background plane, any number
+//     actor <kind> <x> <y> <vx> <vy>
+//                                enemy, platform or projectile at a cell,
+//                                velocity in cells per second, any number
+//     map
+//     #######                    one line per row, top row first:
+//     #P..LI#                    '#' stone, 'F' finish, 'L' lava, 'I' ice,
+//     #######                    'P' player start, anything else is empty
+//     end
+// ------------------------------------------------------------------------
+bool parseLevelText(const std::string& path, Level& level);
+
+// writes the compiled form of a level; the hash identifies its text source.
+// The file is replaced in one rename (see replaceFile), so a LevelFile that
+// still maps the old one is unaffected
+// ------------------------------------------------------------------------
+bool writeLevelBinary(const std::string& path, const Level& level,
+    uint64_t sourceHash = 0);
+
+// maps a compiled level file; no text is parsed
+// ------------------------------------------------------------------------
+bool readLevelBinary(const std::string& path, Level& level);
+
+// makes sure the compiled form of a level is up to date and returns its path:
+// the level's ".bin" file in the cache directory (see cachePath), recompiled
+// from the text when it is missing or was compiled from other contents, or
+// path itself if it does not end in ".lvl"
+// ------------------------------------------------------------------------
+bool compileLevel(const std::string& path, std::string& compiledPath);
+
+// loads a level through compileLevel: a text level from its compiled file in
+// the cache directory, anything else as a compiled file directly
+// ------------------------------------------------------------------------
+bool loadLevel(const std::string& path, Level& level);
+
+// Memory mapped compiled level. Nothing is decoded up front, chunks are read
+// in place, so opening a level costs the same however large it is. Reads are
+// const and may come from several threads
+class LevelFile {
+public:
+    LevelFile();
+
+    // ------------------------------------------------------------------------
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+
+    glm::vec3 playerStart() const;
+    void backgrounds(std::vector<glm::vec3>& positions) const;
+    void actors(std::vector<ActorSpawn>& spawns) const;
+
+    // cell of the lower left corner of chunk (0, 0), the cells the level's
+    // tiles cover from there and the chunk grid size
+    // ------------------------------------------------------------------------
+    glm::ivec2 origin() const;
+    glm::ivec2 size() const;
+    int chunksX() const { return chunkColumns; }
+    int chunksY() const { return chunkRows; }
+
+    // TILE_CHUNK_SIZE squared cells of one chunk, row by row
+    // ------------------------------------------------------------------------
+    const unsigned char* chunk(int chunkX, int chunkY) const;
+
+    // appends the tiles of the cells [first, last], clipped to the level
+    // ------------------------------------------------------------------------
+    void tiles(const glm::ivec2& first, const glm::ivec2& last,
+        std::vector<Tile>& out) const;
+
+private:
+    MappedFile file;
+    const LevelFileHeader* header;
+    const unsigned char* cells;
+    int chunkColumns;
+    int chunkRows;
+};
+
+#endif // LEVEL_HPP
@@ -0,0 +1,124 @@
+#ifndef LEVEL_STREAM_HPP
+#define LEVEL_STREAM_HPP
+
+#include <glm/glm.hpp>
+
+#include <Block.hpp>
+#include <Level.hpp>
+#include <Mesh.hpp>
+#include <TileMap.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One chunk prepared on the stream thread: the collision masks for the
+// TileMap and the merged static meshes of its materials
+struct StreamedChunk {
+    struct Material {
+        Block_Type type;
+        glm::ivec2 origin; // translation of the mesh, see StaticGeometry
+        MeshData mesh;
+    };
+
+    glm::ivec2 chunk;
+    std::vector<unsigned char> layers; // TILE_CHUNK_SIZE squared, row by row
+    std::vector<Material> materials;   // only materials with geometry
+    size_t bytes;                      // resident size once uploaded
+    double loadTime;                   // milliseconds to read and mesh
+};
+
+// Streams a compiled level chunk by chunk around the player. A worker thread
+// reads chunks from the mapped level file and meshes them; the simulating
+// thread installs their collision and hands them to the renderer. Chunks within
+// radius of the player's chunk are always resident (loaded synchronously if
+// the worker has not got to them yet), further chunks are prefetched along
+// the direction of travel while they fit the memory budget, and the chunks
+// least likely to be needed are evicted when it is exceeded. Neither memory
+// nor the cost of loading a chunk depends on the size of the level
+class LevelStream {
+public:
+    // budget is in bytes of collision and mesh data; lookahead is the number
+    // of chunks prefetched ahead of the player
+    // ------------------------------------------------------------------------
+    LevelStream(size_t budget, int radius = 1, int lookahead = 3);
+    ~LevelStream();
+
+    LevelStream(const LevelStream&) = delete;
+    LevelStream& operator=(const LevelStream&) = delete;
+
+    // switches to a compiled level (see compileLevel) with nothing resident;
+    // occluders and backFaces are passed on to StaticGeometry
+    // ------------------------------------------------------------------------
+    bool open(const std::string& compiledPath, const bool* occluders,
+        bool backFaces);
+    void close();
+
+    // header data of the open level; tiles stay in the file
+    // ------------------------------------------------------------------------
+    const LevelFile& file() const { return level; }
+
+    // on the simulating thread, before each batch of ticks: requests chunks
+    // around position (a world position) and ahead along velocity, installs
+    // finished chunks into tiles and returns them for upload, and evicts
+    // chunks over budget from tiles and returns their coordinates
+    // ------------------------------------------------------------------------
+    void update(const glm::vec3& position, const glm::vec3& velocity,
+        TileMap& tiles, std::vector<StreamedChunk>& loaded,
+        std::vector<glm::ivec2>& evicted);
+
+    // stable id of a chunk, e.g. to tag its GPU buffers
+    // ------------------------------------------------------------------------
+    int chunkId(const glm::ivec2& chunk) const;
+
+    size_t residentBytes() const { return bytesResident; }
+    unsigned int residentChunks() const { return static_cast<unsigned int>(resident.size()); }
+    // chunks the simulating thread had to load itself because they were needed now
+    unsigned int stalls() const { return stallCount; }
+    double averageLoadTime() const;
+
+private:
+    enum Chunk_State { CHUNK_NONE, CHUNK_QUEUED, CHUNK_RESIDENT };
+
+    struct Resident {
+        glm::ivec2 chunk;
+        size_t bytes;
+    };
+
+    void work();
+    void prepare(const glm::ivec2& chunk, StreamedChunk& result) const;
+    void install(StreamedChunk& chunk, TileMap& tiles,
+        std::vector<StreamedChunk>& loaded);
+    Chunk_State& stateOf(const glm::ivec2& chunk);
+
+    size_t budget;
+    int radius;
+    int lookahead;
+
+    LevelFile level;
+    bool occluders[BLOCK_TYPE_COUNT];
+    bool backFaces;
+
+    // simulating thread bookkeeping, one state per chunk of the level
+    std::vector<Chunk_State> states;
+    std::vector<Resident> resident;
+    size_t bytesResident;
+    size_t bytesLoaded;
+    size_t averageBytes; // of a loaded chunk, a guess until the first one
+    unsigned int stallCount;
+    double loadTimeTotal;
+    unsigned int loadCount;
+
+    // shared with the worker; requests are in priority order
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<glm::ivec2> requests;
+    std::vector<StreamedChunk> finished;
+    bool stopping;
+    std::thread worker;
+};
+
+#endif // LEVEL_STREAM_HPP
@@ -0,0 +1,117 @@
+#ifndef LIGHT_GRID_HPP
+#define LIGHT_GRID_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <Frustum.hpp>
+#include <UniformBuffer.hpp>
+
+#include <vector>
+
+// Texture units of the buffer textures the material shader reads the point
+// lights from; unit 0 is the block texture array
+enum Light_Texture_Unit {
+    LIGHT_TEXTURE_UNIT = 1,       // RGBA32F, position and radius, then colour
+    LIGHT_CELL_TEXTURE_UNIT = 2,  // RG32UI, first index and count per cell
+    LIGHT_INDEX_TEXTURE_UNIT = 3  // R32UI, light indices of all cells
+};
+
+// Point lights binned into a 2D grid over the level plane. The camera looks at
+// the level from the side, so a world-space grid in x and y does the job of
+// a cluster grid: the lights whose sphere intersects the frustum are binned
+// into the cells their bounds overlap (at most columns x rows cells
+// stretched over the visible lights), and a fragment only loops over the
+// lights of its own cell. Shading cost follows the local light density,
+// not the total number of lights. Culling tests the bounds of each chunk's
+// lights before the lights themselves, and the grid is only rebuilt and
+// uploaded when the lights or the visible ones change
+class LightGrid {
+public:
+    LightGrid(int columns = 32, int rows = 16);
+    ~LightGrid();
+
+    LightGrid(const LightGrid&) = delete;
+    LightGrid& operator=(const LightGrid&) = delete;
+
+    // lights of a streamed chunk carry its id and leave with removeChunk
+    // ------------------------------------------------------------------------
+    void clear();
+    void addLight(const glm::vec3& position, float radius, const glm::vec3& color,
+        int chunk = -1);
+    void removeChunk(int chunk);
+
+    // bins the visible lights if they changed, uploads the buffers and fills
+    // in the grid part of uniforms. brightness scales every light's colour in
+    // the shader, a brightness of zero turns them all off
+    // ------------------------------------------------------------------------
+    void update(const Frustum& frustum, float brightness, LightUniforms& uniforms);
+
+    // binds the three buffer textures to their Light_Texture_Unit
+    // ------------------------------------------------------------------------
+    void bind() const;
+
+    unsigned int lightCount() const { return static_cast<unsigned int>(lights.size()); }
+    unsigned int visibleLights() const {
+        return lit ? static_cast<unsigned int>(visible.size()) : 0;
+    }
+    // largest number of lights a single cell held in the last update
+    unsigned int maxCellLights() const { return lit ? maxPerCell : 0; }
+
+private:
+    struct PointLight {
+        glm::vec3 position;
+        float radius;
+        glm::vec3 color;
+        int chunk;
+    };
+
+    // a run of consecutive lights of one chunk and the box around them
+    struct ChunkLights {
+        int chunk;
+        size_t first;
+        size_t count;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+
+    struct BufferTexture {
+        GLuint buffer;
+        GLuint texture;
+    };
+
+    static void createBufferTexture(BufferTexture& target, GLenum format);
+    static void upload(const BufferTexture& target, const void* data, size_t size);
+
+    void group(size_t light);
+    void cull(const Frustum& frustum);
+    void bin();
+
+    int columns;
+    int rows;
+    std::vector<PointLight> lights;
+    std::vector<ChunkLights> chunks;
+    bool changed; // lights added or removed since the last bin
+
+    // scratch of the last update, kept to avoid reallocating every frame
+    std::vector<unsigned int> visible;
+    std::vector<unsigned int> culled; // this frame's, swapped into visible
+    std::vector<glm::ivec4> cellRanges; // first and last cell of each visible light
+    std::vector<unsigned int> cells;    // first index and count per cell
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec4> texels;
+    unsigned int maxPerCell;
+    bool lit;
+
+    // the grid the last bin built
+    glm::vec2 gridOrigin;
+    glm::vec2 cellSize;
+    glm::ivec2 gridSize;
+    glm::vec2 gridDepth;
+
+    BufferTexture lightTexels;
+    BufferTexture cellTable;
+    BufferTexture indexList;
+};
+
+#endif // LIGHT_GRID_HPP
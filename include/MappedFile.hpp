@@ -0,0 +1,79 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The contents are paged in by the
+// OS on first access, so opening a file does no reading or copying
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // ------------------------------------------------------------------------
+    bool open(const std::string& path);
+    void close();
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fd;
+#endif
+    const unsigned char* bytes;
+    size_t length;
+};
+
+// size and modification time of a file, used to tell whether a derived cache
+// file is still up to date; false if the file does not exist
+// ------------------------------------------------------------------------
+bool fileStamp(const std::string& path, unsigned long long& size,
+    long long& modified);
+
+// One contiguous piece of a file written by replaceFile
+struct FilePart {
+    const void* data;
+    size_t size;
+};
+
+// writes the parts, in order, to a temporary file next to path and renames
+// it over path. Readers that still have the old file mapped keep its
+// contents, and no reader ever sees a partly written file; path is left
+// untouched if anything fails
+// ------------------------------------------------------------------------
+bool replaceFile(const std::string& path, const FilePart* parts, size_t count);
+
+// FNV-1a over size bytes, continuing from hash so several pieces can be
+// chained into one key
+// ------------------------------------------------------------------------
+const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ULL;
+unsigned long long hashBytes(const void* data, size_t size,
+    unsigned long long hash = FNV_OFFSET_BASIS);
+
+// FNV-1a over a file's contents, which keys a derived cache file on exactly
+// the source it was built from; false if the file cannot be read
+// ------------------------------------------------------------------------
+bool fileHash(const std::string& path, unsigned long long& hash);
+
+// directory derived files (cooked textures, program binaries, compiled
+// levels) are written to, created on first use: ICYHOT_CACHE_DIR, which the
+// build points into its own tree, or $XDG_CACHE_HOME/icyhot (~/.cache/icyhot)
+// when that is not defined. Nothing is ever written next to the sources
+// ------------------------------------------------------------------------
+std::string cacheDirectory();
+
+// file in the cache directory derived from source: the source's file name,
+// a hash of its full path, so equally named sources in different
+// directories do not collide, and suffix
+// ------------------------------------------------------------------------
+std::string cachePath(const std::string& source, const std::string& suffix);
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,70 @@
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Unpacked vertex as meshes are built on the CPU
+struct MeshVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+// Indexed triangle list
+struct MeshData {
+    std::vector<MeshVertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// GPU vertex, 16 bytes instead of 32: half float position and uv, normal as
+// signed normalized 10_10_10_2
+struct PackedVertex {
+    uint16_t position[4]; // xyz, w is padding
+    uint32_t normal;
+    uint16_t uv[2];
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+// unit cube centred on the origin, 4 vertices per face so every face keeps
+// its own normal and uvs
+// ------------------------------------------------------------------------
+MeshData cubeMesh();
+
+// Static indexed mesh in packed vertex format. Attributes are laid out as
+// position (0), normal (1) and uv (2) and may be attached to any vertex
+// array, e.g. alongside per-instance attributes. Indices are 16 bit when
+// the vertex count allows it
+class Mesh {
+public:
+    explicit Mesh(const MeshData& data);
+    ~Mesh();
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    // points attributes 0-2 and the element buffer of the bound vertex array
+    // at this mesh
+    // ------------------------------------------------------------------------
+    void bindAttributes() const;
+
+    // draw with a vertex array set up by bindAttributes
+    // ------------------------------------------------------------------------
+    void draw() const;
+    void drawInstanced(GLsizei instances) const;
+
+    unsigned int vertexCount() const { return vertices; }
+    unsigned int indexCount() const { return indices; }
+
+private:
+    unsigned int VBO;
+    unsigned int EBO;
+    unsigned int vertices;
+    unsigned int indices;
+    GLenum indexType;
+};
+
+#endif // MESH_HPP
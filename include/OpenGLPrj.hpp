@@ -8,10 +8,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-// Reference: https://github.com/nothings/stb/blob/master/stb_image.h#L4
-// To use stb_image, add this in *one* C++ source file.
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+// stb_image is implemented in TextureCache.cpp, the only place that decodes
+// images, so the game and the headless benchmark share it
 
 #endif //~ OpenGLPrj Header
\ No newline at end of file
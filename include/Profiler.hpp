@@ -0,0 +1,165 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-frame counters of GL work, incremented at the call sites
+enum Frame_Counter {
+    COUNTER_DRAW_CALLS,
+    COUNTER_STATE_CHANGES, // program and vertex array binds
+    COUNTER_UNIFORM_CALLS, // glUniform* and uniform buffer updates
+    COUNTER_TEXTURE_BINDS,
+    FRAME_COUNTER_COUNT
+};
+
+// Frame profiler: nested CPU scopes, GPU passes timed with GL_TIME_ELAPSED
+// queries and the frame counters. Every frame keeps its events in a ring of
+// fixed capacity, aggregates per scope percentiles over the last frames and
+// can dump the retained events as Chrome trace JSON (chrome://tracing,
+// Perfetto).
+//
+// GPU queries are double buffered: a pass's result is read one frame later
+// when it is available, and before its query object is reused otherwise, so
+// the CPU does not wait on the GPU. GPU events are placed at the time the CPU
+// issued the pass. Scope names must be string literals (they are keyed by
+// address). A disabled profiler only keeps the counters
+class Profiler {
+public:
+    // frames is the number of frames kept for percentiles and in the trace
+    // ------------------------------------------------------------------------
+    explicit Profiler(size_t frames = 1024);
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void setEnabled(bool enabled);
+    bool enabled() const { return active; }
+
+    // beginFrame collects finished GPU queries and resets the counters,
+    // endFrame records the frame's duration and counters
+    // ------------------------------------------------------------------------
+    void beginFrame();
+    void endFrame();
+
+    // ------------------------------------------------------------------------
+    void beginScope(const char* name);
+    void endScope();
+
+    // a scope timed on the simulation thread and handed over afterwards; it
+    // is kept on a track of its own
+    // ------------------------------------------------------------------------
+    void addThreadScope(const char* name, std::chrono::steady_clock::time_point start,
+        double seconds);
+
+    // GPU passes cannot nest
+    // ------------------------------------------------------------------------
+    void beginGpu(const char* name);
+    void endGpu();
+
+    static void count(Frame_Counter counter, unsigned int amount = 1) {
+        counters[counter] += amount;
+    }
+    static unsigned int frameCount(Frame_Counter counter) { return counters[counter]; }
+
+    // p50/p95/p99/max of every scope, pass and counter over the kept frames
+    // ------------------------------------------------------------------------
+    void report(std::ostream& out) const;
+
+    // ------------------------------------------------------------------------
+    bool dumpChromeTrace(const std::string& path) const;
+
+private:
+    enum Track { CPU_TRACK = 1, GPU_TRACK = 2, SIMULATION_TRACK = 3 };
+
+    struct Event {
+        const char* name;
+        double start;    // microseconds since the profiler was created
+        double duration; // microseconds
+        unsigned char track;
+    };
+
+    struct Frame {
+        double start;
+        double duration;
+        unsigned int counters[FRAME_COUNTER_COUNT];
+    };
+
+    // last durations of one scope or pass, in microseconds
+    struct Samples {
+        std::vector<float> values;
+        size_t next;
+        unsigned char track;
+    };
+
+    struct GpuPass {
+        const char* name;
+        GLuint queries[2];
+        double issued[2];
+        bool pending[2];
+    };
+
+    // prefix of a track in the report, category in the trace
+    static const char* trackName(unsigned char track);
+    double now() const;
+    void record(const char* name, double start, double duration,
+        unsigned char track);
+    void collect(GpuPass& pass, int slot, bool wait);
+
+    bool active;
+    std::chrono::steady_clock::time_point epoch;
+    unsigned long long frameIndex;
+    double frameStart;
+
+    std::vector<Event> events;
+    size_t eventHead;   // next slot in the event ring
+    size_t eventCount;
+    std::vector<Frame> frames;
+    size_t recordedFrames; // frames so far, the ring index is modulo
+    std::unordered_map<const char*, Samples> samples;
+
+    // open CPU scopes, innermost last
+    std::vector<std::pair<const char*, double> > open;
+    std::vector<GpuPass> passes;
+    GpuPass* openPass;
+
+    static unsigned int counters[FRAME_COUNTER_COUNT];
+};
+
+// RAII CPU scope
+class ProfileScope {
+public:
+    ProfileScope(Profiler& profiler, const char* name) : profiler(profiler) {
+        profiler.beginScope(name);
+    }
+    ~ProfileScope() { profiler.endScope(); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler& profiler;
+};
+
+// RAII GPU pass
+class GpuProfileScope {
+public:
+    GpuProfileScope(Profiler& profiler, const char* name) : profiler(profiler) {
+        profiler.beginGpu(name);
+    }
+    ~GpuProfileScope() { profiler.endGpu(); }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    Profiler& profiler;
+};
+
+#endif // PROFILER_HPP
@@ -0,0 +1,128 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <BlockRenderer.hpp>
+#include <FileWatcher.hpp>
+#include <Frustum.hpp>
+#include <LightGrid.hpp>
+#include <Mesh.hpp>
+#include <Profiler.hpp>
+#include <Shader.hpp>
+#include <SimulationThread.hpp>
+#include <TextureArray.hpp>
+#include <UniformBuffer.hpp>
+
+#include <string>
+#include <vector>
+
+// The game as drawn every frame: programs, textures, the streamed level with
+// its lights and its simulation. Whoever owns the GL context (the game window
+// or a headless benchmark) owns the camera and input. The simulation either
+// runs on its own thread (startSimulation) or is advanced by update; either
+// way the scene draws the latest world snapshot into whatever framebuffer is
+// bound
+class Scene {
+public:
+    // loads the programs from "<resources>shaders/" and the texture array
+    // from "<resources>textures/". Needs a current GL 3.3 context
+    // ------------------------------------------------------------------------
+    Scene(const std::string& resources, Profiler& profiler);
+    ~Scene();
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    // compiles and opens a level and restarts the simulation in it; a level
+    // that fails to load leaves the current one in place
+    // ------------------------------------------------------------------------
+    bool loadLevel(const std::string& path);
+
+    // hot reload: every shader source and texture image, and picking up one
+    // changed file. A shader that fails to compile keeps its old program
+    // ------------------------------------------------------------------------
+    void watch(FileWatcher& watcher) const;
+    void reload(const std::string& path);
+
+    // streams the chunks around the player, then runs the fixed ticks that
+    // fit into deltaTime on this thread. Events in input fire on the first
+    // tick only, the direction stays held; every tick's input is appended to
+    // recorded unless it is null
+    // ------------------------------------------------------------------------
+    void update(float deltaTime, TickInput& input, std::vector<TickInput>* recorded);
+
+    // runs the simulation on its own thread in real time, fed by post();
+    // recorded is only written by that thread and can be read after stop
+    // ------------------------------------------------------------------------
+    void startSimulation(std::vector<TickInput>* recorded);
+    void stopSimulation();
+
+    // forwards an input change, stamped with simulationClock(), to the
+    // simulation thread; dropped if too many are queued
+    // ------------------------------------------------------------------------
+    bool post(const InputEvent& event) { return world.post(event); }
+    double simulationClock() const { return world.now(); }
+
+    // once per frame while the thread runs: uploads the chunks it streamed
+    // and takes over its newest snapshot
+    // ------------------------------------------------------------------------
+    void sync();
+
+    // draws the level, the player between its last two ticks and the lamp
+    // into the bound framebuffer; time drives the shader animations
+    // ------------------------------------------------------------------------
+    void render(const glm::mat4& projection, const glm::mat4& view,
+        const glm::vec3& viewPos, float time);
+
+    void setTrace(TraceRing* ring);
+
+    const WorldSnapshot& snapshot() const { return world.snapshot(); }
+    const BlockRenderer& blocks() const { return blockRenderer; }
+    const LightGrid& lights() const { return lightGrid; }
+
+private:
+    void configureMaterialShader(Shader& shader, Uniform<float>& uShininess);
+    void configureLampShader(Shader& shader);
+    void addBackgrounds();
+    void receiveChunks();
+    void addChunk(const StreamedChunk& chunk);
+
+    Profiler& profiler;
+    std::string shaderLocation;
+
+    Shader lightingShader;
+    Shader lightingShaderGeneral;
+    Shader lampShader;
+    Uniform<float> uShininess;
+    Uniform<float> uShininessGeneral;
+    Uniform<glm::mat4> uLampModel;
+
+    Mesh cube;
+    unsigned int lightVAO;
+
+    TextureArray textures;
+    unsigned int blockLayers[BLOCK_TYPE_COUNT];
+    unsigned int rickFrames;
+    // first texture layer and animation frame count of each Entity_Kind
+    unsigned int actorLayers[ENTITY_KIND_COUNT];
+    unsigned int actorFrames[ENTITY_KIND_COUNT];
+    unsigned int backgroundLayers[2];
+
+    UniformBuffer frameBuffer;
+    UniformBuffer lightBuffer;
+    FrameUniforms frameUniforms;
+    LightUniforms lightUniforms;
+    glm::vec3 lightPos;
+
+    SimulationThread world;
+    float alpha; // position between the snapshot's previous tick and its last
+
+    BlockRenderer blockRenderer;
+    LightGrid lightGrid;
+    Frustum frustum;
+    ChunkChange chunkChange;
+};
+
+#endif // SCENE_HPP
@@ -10,6 +10,29 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+
+// A uniform location resolved once by name. Setting it afterwards does no
+// string work; setting an inactive uniform (location -1) is a no-op in GL
+template <typename T> class Uniform {
+public:
+    Uniform() : location(-1) {}
+    explicit Uniform(GLint location) : location(location) {}
+
+    void set(const T& value) const;
+
+    GLint location;
+};
+
+template <> void Uniform<bool>::set(const bool& value) const;
+template <> void Uniform<int>::set(const int& value) const;
+template <> void Uniform<float>::set(const float& value) const;
+template <> void Uniform<glm::vec2>::set(const glm::vec2& value) const;
+template <> void Uniform<glm::vec3>::set(const glm::vec3& value) const;
+template <> void Uniform<glm::vec4>::set(const glm::vec4& value) const;
+template <> void Uniform<glm::mat2>::set(const glm::mat2& value) const;
+template <> void Uniform<glm::mat3>::set(const glm::mat3& value) const;
+template <> void Uniform<glm::mat4>::set(const glm::mat4& value) const;
 
 class Shader {
 public:
@@ -20,14 +43,49 @@ public:
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath);
 
-    // constructor using std::string
+    // constructor using std::string; defines (e.g. "#define FOO\n") are
+    // inserted after the #version line of both stages to build a variant
     // ------------------------------------------------------------------------
-    Shader(const std::string vertexPath, const std::string fragmentPath);
+    Shader(const std::string vertexPath, const std::string fragmentPath,
+        const std::string& defines = "");
 
     // activate the shader
     // ------------------------------------------------------------------------
     void use();
 
+    // recompiles from the source files for hot reload. Returns false and keeps
+    // the running program if the new sources do not compile; on success the
+    // program ID changes, so uniform handles and block bindings must be
+    // resolved again
+    // ------------------------------------------------------------------------
+    bool reload();
+
+    // whether path is one of this program's source files
+    // ------------------------------------------------------------------------
+    bool dependsOn(const std::string& path) const;
+
+    // resolve a uniform once so it can be set in the hot path without a
+    // name lookup
+    // ------------------------------------------------------------------------
+    template <typename T> Uniform<T> uniform(const std::string& name) const {
+        return Uniform<T>(getUniformLocation(name));
+    }
+
+    // attaches a uniform block to a fixed binding point; blocks the program
+    // does not use are ignored
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const std::string& blockName, GLuint binding) const;
+
+    // location from the cache filled at link time, -1 if not active
+    // ------------------------------------------------------------------------
+    GLint getUniformLocation(const std::string& name) const;
+
+    // number of by-name uniform lookups (across all shaders) since the last
+    // reset; call once per frame to check the hot path does no string work
+    // ------------------------------------------------------------------------
+    static unsigned int uniformLookups();
+    static void resetUniformLookups();
+
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string& name, bool value) const;
@@ -64,14 +122,39 @@ public:
 private:
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(unsigned int shader, std::string type);
+    bool checkCompileErrors(unsigned int shader, std::string type);
 
     void readShader(char const* const, Shader::SHADER_TYPE);
 
-    void compileShader();
+    // builds a new program from the current sources and swaps it in; on
+    // failure the previous program (if any) stays
+    // ------------------------------------------------------------------------
+    bool compileShader();
+    void replaceProgram(GLuint program);
+
+    // program binary cache; the key covers both sources and the driver
+    // strings, so any change of either falls back to compiling from source
+    // ------------------------------------------------------------------------
+    static std::string programBinaryPath(const std::string& vertexPath,
+        const std::string& fragmentPath, const std::string& defines);
+    unsigned long long programKey() const;
+    bool loadProgramBinary(unsigned long long key, GLuint& program);
+    void saveProgramBinary(unsigned long long key) const;
+
+    // introspects the linked program's active uniforms
+    // ------------------------------------------------------------------------
+    void cacheUniformLocations();
 
     std::string vertexShader;
     std::string fragmentShader;
+    std::string vertexFile;
+    std::string fragmentFile;
+    std::string defines;
+    std::string binaryPath;
+
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    static unsigned int lookupCount;
 };
 
 #endif // SHADER_HPP
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include <glm/glm.hpp>
+
+#include <Entities.hpp>
+#include <Level.hpp>
+#include <TileMap.hpp>
+#include <Trace.hpp>
+
+// simulation rate
+// The movement constants are tuned per tick at 144 ticks per second,
+// rendering interpolates between ticks at whatever rate the display runs
+const float FIXED_TIMESTEP = 1.0f / 144.0f;
+const float MAX_FRAME_TIME = 0.25f;
+
+// One-shot input events, applied at the start of the next tick
+enum Input_Event { JUMP_EVENT = 1 << 0, RESET_EVENT = 1 << 1, SWITCH_EVENT = 1 << 2 };
+
+// Everything the simulation reads from the player in one tick
+struct TickInput {
+    signed char x;        // held direction, -1 left, 1 right
+    unsigned char events; // Input_Event bits
+};
+
+struct PlayerState {
+    glm::vec3 move; // Displacement in relation to starting position
+    float xMovement;
+    float yMovement;
+    bool isGrounded;
+    bool collision;
+    int animationTick;
+};
+
+// Headless game logic: player movement, gravity, AABB resolution, the
+// lava/ice switch and the level's actors. Has no window or GL dependency and
+// is fully determined by the level and the sequence of tick inputs
+class Simulation {
+public:
+    explicit Simulation(const Level& level);
+
+    // advances the world by ticks FIXED_TIMESTEPs in one step, the events
+    // firing once. Movement is swept, so the player and the actors do not
+    // tunnel however many ticks are taken at once; the game takes one
+    // ------------------------------------------------------------------------
+    void step(const TickInput& input, unsigned int ticks = 1);
+
+    // puts the player back at the start of the level
+    // ------------------------------------------------------------------------
+    void reset();
+
+    // cells of the level's lower left and upper right corner. The outermost
+    // ring of cells is the level's wall, the player is held inside it; the
+    // constructor takes them from the level's tiles
+    // ------------------------------------------------------------------------
+    void setBounds(const glm::ivec2& first, const glm::ivec2& last);
+
+    // FNV-1a hash of the complete simulation state, equal hashes after the
+    // same input stream mean the run was reproduced exactly
+    // ------------------------------------------------------------------------
+    unsigned long long hash() const;
+
+    const PlayerState& player() const { return playerState; }
+    const glm::vec3& previousMove() const { return lastMove; }
+    const glm::vec3& playerStart() const { return start; }
+    const EntityStore& entities() const { return actors; }
+    const TileMap& tileMap() const { return tiles; }
+    // streamed levels install and evict collision chunks between ticks
+    TileMap& tileMap() { return tiles; }
+    char state() const { return currentState; }
+    unsigned long long tick() const { return tickCount; }
+
+    // structured per-tick trace, nullptr (the default) disables tracing
+    void setTrace(TraceRing* ring) { trace = ring; }
+
+    //Player
+    static constexpr float playerScale = 0.75f;
+
+    //Player Movement
+    static constexpr float velocity = 0.0625f;
+    static constexpr float xStride = 1.0f;
+    static constexpr float yJump = 1.75f;
+    static constexpr float gravity = 0.0625f;
+
+private:
+    void movePlayer(unsigned int ticks);
+    void respawn();
+    void interactWithActors(unsigned char activeLayers, unsigned int ticks);
+    void traceEvent(Trace_Event_Type type, int xCollisionType = 0,
+        int yCollisionType = 0, Trace_Stop_Reason stopReason = STOP_NONE);
+
+    TileMap tiles;
+    glm::vec3 start;
+    glm::vec2 lowMove;  // range of the player's move inside the level's wall
+    glm::vec2 highMove;
+    EntityStore actors;
+
+    PlayerState playerState;
+    glm::vec3 lastMove;
+    char currentState; // 'L' lava or 'I' ice blocks are solid
+    unsigned long long tickCount;
+    TraceRing* trace;
+};
+
+#endif // SIMULATION_HPP
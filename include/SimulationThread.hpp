@@ -0,0 +1,173 @@
+#ifndef SIMULATION_THREAD_HPP
+#define SIMULATION_THREAD_HPP
+
+#include <glm/glm.hpp>
+
+#include <Entities.hpp>
+#include <LevelStream.hpp>
+#include <Profiler.hpp>
+#include <Simulation.hpp>
+#include <SpscQueue.hpp>
+#include <TripleBuffer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One input change forwarded to the simulation thread. From time on the
+// player holds direction x; events fire on the tick that covers time
+struct InputEvent {
+    double time;          // seconds on SimulationThread::now()
+    signed char x;        // held direction, -1 left, 1 right
+    unsigned char events; // Input_Event bits
+};
+
+// A streamed chunk handed to the renderer: loaded (its collision is already
+// installed, its meshes wait for upload) or evicted, in which case only
+// chunk.chunk is set
+struct ChunkChange {
+    bool evicted;
+    StreamedChunk chunk;
+};
+
+// One scope timed on the simulation thread, handed to the renderer's
+// thread for its profiler (see Profiler::addThreadScope)
+struct ThreadScope {
+    const char* name; // string literal
+    std::chrono::steady_clock::time_point start;
+    double seconds;
+};
+
+// The world as it was after a tick: everything the renderer reads. A
+// published snapshot is never written again until the renderer gives it
+// back, so it needs no locking
+struct WorldSnapshot {
+    unsigned long long tick;
+    double time; // simulation clock at the end of the tick
+    glm::vec3 playerStart;
+    glm::vec3 move;
+    glm::vec3 previousMove;
+    int animationTick;
+    char state; // 'L' or 'I'
+    ActorSnapshot actors;
+    unsigned int residentChunks;
+    size_t residentBytes;
+    unsigned int streamingStalls;
+};
+
+// Owns the level stream and the simulation of the open level and runs them
+// at FIXED_TIMESTEP, either on a thread of its own (start) or stepped by the
+// caller (advance) where runs have to be reproducible. The renderer's thread
+// talks to it only through lock-free hand overs: timestamped input events
+// go in through an SPSC queue, loaded and evicted chunks come out through
+// another, and the world after each batch of ticks is published through a
+// triple buffer. Slow frames therefore never hold up the ticks, and ticks
+// run while the renderer submits.
+//
+// open, start, stop and advance are called from the renderer's thread
+class SimulationThread {
+public:
+    // budget and occluders are passed on to LevelStream
+    // ------------------------------------------------------------------------
+    SimulationThread(size_t streamBudget, const bool* occluders);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    // switches to a compiled level (see compileLevel), drops everything
+    // still queued for the old one and publishes its first snapshot. A
+    // running thread is stopped while it does and started again after
+    // ------------------------------------------------------------------------
+    bool open(const std::string& compiledPath);
+
+    // header data of the open level, and the stable id of one of its chunks
+    // ------------------------------------------------------------------------
+    const LevelFile& file() const { return levelStream.file(); }
+    int chunkId(const glm::ivec2& chunk) const { return levelStream.chunkId(chunk); }
+
+    // set while the thread is stopped; every tick's input is appended to
+    // recorded unless it is null
+    // ------------------------------------------------------------------------
+    void setTrace(TraceRing* ring);
+    void setRecording(std::vector<TickInput>* recorded) { recording = recorded; }
+
+    // streams the chunks around the player, then runs the fixed ticks that
+    // fit into deltaTime on the calling thread. Events in input fire on the
+    // first tick only, the direction stays held
+    // ------------------------------------------------------------------------
+    void advance(float deltaTime, TickInput& input, Profiler& profiler);
+
+    // time advance has accumulated towards the next tick
+    // ------------------------------------------------------------------------
+    float lag() const { return accumulator; }
+
+    // ticks on the thread, in real time from now on; a hitch longer than
+    // MAX_FRAME_TIME is skipped rather than caught up
+    // ------------------------------------------------------------------------
+    void start();
+    void stop();
+    bool running() const { return worker.joinable(); }
+
+    // seconds since construction, the clock input events are stamped with
+    // ------------------------------------------------------------------------
+    double now() const;
+
+    // renderer side: false if the input queue is full and the event dropped
+    // ------------------------------------------------------------------------
+    bool post(const InputEvent& event) { return inputs.push(event); }
+
+    // renderer side: takes the next chunk change, false if there is none
+    // ------------------------------------------------------------------------
+    bool takeChunk(ChunkChange& change) { return chunks.pop(change); }
+
+    // renderer side: takes the next timed "streaming" or "physics" scope of
+    // the thread, false if there is none. Scopes the renderer is too slow
+    // to take are dropped
+    // ------------------------------------------------------------------------
+    bool takeScope(ThreadScope& scope) { return scopes.pop(scope); }
+
+    // renderer side: switches to the newest published snapshot, if any
+    // ------------------------------------------------------------------------
+    bool acquire() { return snapshots.acquire(); }
+    const WorldSnapshot& snapshot() const { return snapshots.read(); }
+
+private:
+    void run();
+    void applyInput(double until);
+    void stream();
+    void tick(const TickInput& input);
+    void publish(double time);
+    void timed(const char* name, std::chrono::steady_clock::time_point start,
+        std::chrono::steady_clock::time_point end);
+
+    bool occluders[BLOCK_TYPE_COUNT];
+    LevelStream levelStream;
+    Simulation sim;
+    TraceRing* trace;
+    std::vector<TickInput>* recording;
+    float accumulator; // advance only
+
+    // simulation thread
+    std::chrono::steady_clock::time_point epoch;
+    double simulated; // clock time the last tick ended
+    TickInput held;
+    InputEvent pending; // popped but not due yet
+    bool hasPending;
+    std::deque<ChunkChange> unsent; // waiting for room in the queue
+    std::vector<StreamedChunk> loaded;
+    std::vector<glm::ivec2> evicted;
+
+    SpscQueue<InputEvent> inputs;
+    SpscQueue<ChunkChange> chunks;
+    SpscQueue<ThreadScope> scopes;
+    TripleBuffer<WorldSnapshot> snapshots;
+
+    std::atomic<bool> stopping;
+    std::thread worker;
+};
+
+#endif // SIMULATION_THREAD_HPP
@@ -0,0 +1,58 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free queue between exactly one producer thread and exactly
+// one consumer thread. Each side only writes its own index and reads the
+// other's, so push() and pop() are wait-free; a full queue rejects the push
+// and leaves it to the producer to retry. Items are moved in and out of
+// preallocated slots, so nothing is allocated once the slots' own buffers
+// have grown
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : slots(capacity + 1), head(0), tail(0) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer only; false (and item untouched) if the queue is full
+    // ------------------------------------------------------------------------
+    bool push(T& item) {
+        size_t write = tail.load(std::memory_order_relaxed);
+        size_t next = write + 1 == slots.size() ? 0 : write + 1;
+        if (next == head.load(std::memory_order_acquire))
+            return false;
+        slots[write] = std::move(item);
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const T& item) {
+        T copy(item);
+        return push(copy);
+    }
+
+    // consumer only; false if the queue is empty
+    // ------------------------------------------------------------------------
+    bool pop(T& item) {
+        size_t read = head.load(std::memory_order_relaxed);
+        if (read == tail.load(std::memory_order_acquire))
+            return false;
+        item = std::move(slots[read]);
+        head.store(read + 1 == slots.size() ? 0 : read + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> slots; // one stays empty to tell a full queue from an empty one
+    // each index on its own cache line, so the two threads do not contend
+    alignas(64) std::atomic<size_t> head; // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail; // next slot to push, written by the producer
+};
+
+#endif // SPSC_QUEUE_HPP
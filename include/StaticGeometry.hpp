@@ -0,0 +1,57 @@
+#ifndef STATIC_GEOMETRY_HPP
+#define STATIC_GEOMETRY_HPP
+
+#include <glm/glm.hpp>
+
+#include <Block.hpp>
+#include <Mesh.hpp>
+#include <TileMap.hpp>
+
+#include <vector>
+
+// Merged static meshes of the level tiles. Faces hidden by a neighbouring
+// tile are dropped, and the remaining coplanar faces are greedily merged:
+// the front and back sides into rectangles, the edges into runs. Merged
+// faces get uvs that count tiles, so GL_REPEAT tiles the texture once per
+// block as before
+class StaticGeometry {
+public:
+    // occluders[t] says whether a tile of type t hides the faces of its
+    // neighbours; it must be false for materials that can be switched off.
+    // Tiles of the same type always hide each other. Back faces (-z) are
+    // only emitted if backFaces is set
+    // ------------------------------------------------------------------------
+    StaticGeometry(const std::vector<Tile>& tiles, const bool* occluders,
+        bool backFaces);
+
+    // cell range covered by the tiles, empty (min > max) without tiles
+    // ------------------------------------------------------------------------
+    glm::ivec2 minCell() const;
+    glm::ivec2 maxCell() const;
+
+    // merges the faces of the given material's cells within [first, last],
+    // so the level can be split into chunks that are culled separately;
+    // neighbours outside the range still hide faces. Positions are relative
+    // to origin, the lowest cell of the range, which must be added back as
+    // the instance translation so large levels keep half float precision
+    // ------------------------------------------------------------------------
+    MeshData build(Block_Type type, const glm::ivec2& first,
+        const glm::ivec2& last, glm::ivec2& origin) const;
+
+private:
+    int at(int x, int y) const;
+    bool exposed(Block_Type type, int x, int y, int dx, int dy) const;
+
+    bool occluders[BLOCK_TYPE_COUNT];
+    bool backFaces;
+
+    // dense type grid with a one cell empty border, so neighbour lookups of
+    // cells inside need no bounds checks
+    int minX;
+    int minY;
+    int width;
+    int height;
+    std::vector<signed char> cells;
+};
+
+#endif // STATIC_GEOMETRY_HPP
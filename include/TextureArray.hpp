@@ -0,0 +1,79 @@
+#ifndef TEXTURE_ARRAY_HPP
+#define TEXTURE_ARRAY_HPP
+
+#include <glad/glad.h>
+
+#include <TextureCache.hpp>
+
+#include <string>
+#include <vector>
+
+// All block, player and background images as layers of one
+// GL_TEXTURE_2D_ARRAY, so the whole level is drawn without a texture bind
+// between batches. Images of a different size are resampled to the layer
+// size. Where S3TC is available the layers are stored as BC1 (or BC3 with
+// alpha) mip chains cooked once and cached on disk. Decoding and cooking run
+// on worker threads; the GL thread streams each layer through a pixel buffer
+// as soon as it is ready
+class TextureArray {
+public:
+    // time spent on one layer, in milliseconds
+    struct LayerTiming {
+        std::string path;
+        double decode; // decode or cache read, on a worker thread
+        double upload; // PBO copy and texture upload, on the GL thread
+        bool cached;   // compressed chain came from the cache
+    };
+
+    // alpha keeps an alpha channel, which costs BC3 instead of BC1
+    // ------------------------------------------------------------------------
+    TextureArray(int width, int height, bool alpha = false);
+    ~TextureArray();
+
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    // queues an image for the next layer and returns the layer index; the
+    // file is not touched until upload(). A missing file leaves a black layer
+    // so the indices stay stable
+    // ------------------------------------------------------------------------
+    unsigned int addLayer(const std::string& path);
+
+    // called once after the last addLayer: prepares all layers concurrently,
+    // uploads them in completion order and prints the per-layer timings.
+    // Uncompressed arrays build their mipmaps on the GPU
+    // ------------------------------------------------------------------------
+    void upload(unsigned int threadCount = 0);
+
+    // hot reload: decodes (or recooks) every layer added from path again and
+    // uploads it in place on the calling GL thread. False if path is not a
+    // layer of this array
+    // ------------------------------------------------------------------------
+    bool reloadLayer(const std::string& path);
+
+    // ------------------------------------------------------------------------
+    void bind(GLenum unit) const;
+
+    unsigned int layerCount() const { return static_cast<unsigned int>(paths.size()); }
+    const std::string& layerPath(unsigned int layer) const { return paths[layer]; }
+    Texture_Compression compression() const { return format; }
+    const std::vector<LayerTiming>& timings() const { return layerTimings; }
+
+    unsigned int ID;
+
+private:
+    void prepareLayer(unsigned int layer, std::vector<unsigned char>& data,
+        bool& cached) const;
+    void allocate(unsigned int layers);
+    void uploadLayer(unsigned int layer, const std::vector<unsigned char>& data);
+
+    int width;
+    int height;
+    bool alpha;
+    Texture_Compression format;
+    GLuint PBOs[2];
+    std::vector<std::string> paths;
+    std::vector<LayerTiming> layerTimings;
+};
+
+#endif // TEXTURE_ARRAY_HPP
@@ -0,0 +1,37 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// GPU block formats textures are cooked to. BC1 keeps colour only at 4 bits
+// per pixel, BC3 adds an alpha channel at 8 bits per pixel
+enum Texture_Compression { UNCOMPRESSED, BC1_COMPRESSION, BC3_COMPRESSION };
+
+// decodes an image to RGBA8 at exactly width x height, resampling if needed;
+// pixels stay black if the file cannot be read
+// ------------------------------------------------------------------------
+bool decodeImage(const std::string& path, int width, int height,
+    std::vector<unsigned char>& pixels);
+
+// number of levels in a full mip chain down to 1x1
+// ------------------------------------------------------------------------
+unsigned int mipLevelCount(int width, int height);
+
+// bytes of one mip level; compressed levels round up to whole 4x4 blocks
+// ------------------------------------------------------------------------
+size_t mipLevelSize(int width, int height, unsigned int level,
+    Texture_Compression compression);
+
+// fills mips with the compressed mip chain of an image, all levels back to
+// back. The chain is read from the source's ".bc1" / ".bc3" file in the
+// cache directory (see cachePath) when it was cooked from the same source
+// bytes at the same size; otherwise it is cooked with stb_dxt and the cache
+// is rewritten. cached reports which of the two happened
+// ------------------------------------------------------------------------
+bool loadCompressedTexture(const std::string& path, int width, int height,
+    Texture_Compression compression, std::vector<unsigned char>& mips,
+    bool& cached);
+
+#endif // TEXTURE_CACHE_HPP
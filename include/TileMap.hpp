@@ -0,0 +1,108 @@
+#ifndef TILE_MAP_HPP
+#define TILE_MAP_HPP
+
+#include <glm/glm.hpp>
+
+#include <Block.hpp>
+
+#include <vector>
+
+// Collision layers. Solid blocks always collide, the lava and ice layers are
+// switched on and off with the world state
+enum Collision_Layer {
+    SOLID_LAYER = 1 << 0,
+    LAVA_LAYER = 1 << 1,
+    ICE_LAYER = 1 << 2
+};
+
+// cells per side of a chunk, the unit in which collision data and compiled
+// levels are loaded and evicted
+const int TILE_CHUNK_SIZE = 32;
+
+// Where a box swept along a displacement first touches the grid: the
+// fraction of the displacement it gets through, the cell it touches there
+// and the normal of the face it touches. time is 1 if nothing is in the
+// way. overlapping tells whether the box already overlapped a cell where
+// it started
+struct Tile_Sweep {
+    float time;
+    glm::ivec2 cell;
+    glm::vec2 normal;
+    bool overlapping;
+};
+
+// One unit block of the level, addressed by its integer cell (= its center)
+struct Tile {
+    int x;
+    int y;
+    Block_Type type;
+};
+
+// Uniform grid spatial index over the unit-cell level, stored in chunks of
+// TILE_CHUNK_SIZE squared cells. Either built once from all tiles, or reset
+// to an empty chunk grid whose chunks are streamed in and out; cells of
+// chunks that are not resident read as empty. A box query only visits the few
+// cells it overlaps, so its cost does not depend on the number of blocks in
+// the level
+class TileMap {
+public:
+    TileMap();
+
+    // (re)builds the grid so it covers every tile. Blocks that never collide
+    // (background, player) are skipped
+    // ------------------------------------------------------------------------
+    void build(const std::vector<Tile>& tiles);
+
+    // empty grid of chunksX x chunksY chunks whose first cell is origin
+    // ------------------------------------------------------------------------
+    void reset(const glm::ivec2& origin, int chunksX, int chunksY);
+
+    // installs the layer masks of one chunk's cells, row by row; chunks
+    // outside the grid are ignored
+    // ------------------------------------------------------------------------
+    void setChunk(int chunkX, int chunkY, const unsigned char* layers);
+    void clearChunk(int chunkX, int chunkY);
+    bool hasChunk(int chunkX, int chunkY) const;
+
+    // layer mask of a single cell, 0 outside the grid
+    // ------------------------------------------------------------------------
+    unsigned char layersAt(int x, int y) const;
+
+    // whether a cell lies inside the grid, and whether its chunk is loaded
+    // ------------------------------------------------------------------------
+    bool contains(int x, int y) const;
+    bool resident(int x, int y) const;
+
+    // finds the first cell on one of the given layers that strictly overlaps
+    // the box [min, max]; returns false if there is none. Cells are visited
+    // row by row from the bottom, left to right within a row, so a box over
+    // a corner of several blocks gets the lowest, then leftmost one. (The
+    // original game tested its block list in authoring order instead, which
+    // a map has no equivalent of)
+    // ------------------------------------------------------------------------
+    bool firstOverlap(const glm::vec2& min, const glm::vec2& max,
+        unsigned char layers, int& cellX, int& cellY) const;
+
+    // sweeps the box centred at center with half extents half along delta
+    // against the cells on one of the layers. Every cell under the swept
+    // bounds is visited, so nothing is tunnelled through however long delta
+    // is. Cells the box already overlaps at the start do not stop it; they
+    // are only reported, for overlap resolution
+    // ------------------------------------------------------------------------
+    Tile_Sweep sweep(const glm::vec2& center, const glm::vec2& half, const glm::vec2& delta,
+        unsigned char layers) const;
+
+    static unsigned char layerOf(Block_Type type);
+
+private:
+    std::vector<unsigned char>* chunkAt(int chunkX, int chunkY);
+
+    int originX;
+    int originY;
+    int chunkColumns;
+    int chunkRows;
+    // TILE_CHUNK_SIZE squared layer masks per chunk, empty when not resident
+    std::vector<std::vector<unsigned char> > chunks;
+};
+
+#endif // TILE_MAP_HPP
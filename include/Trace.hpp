@@ -0,0 +1,83 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Compile-time switch; building with ICYHOT_TRACE=0 compiles the simulation
+// trace points out
+#ifndef ICYHOT_TRACE
+#define ICYHOT_TRACE 1
+#endif
+
+enum Trace_Event_Type {
+    TRACE_TICK = 0,           // end of a simulation tick
+    TRACE_JUMP = 1,
+    TRACE_RESET = 2,
+    TRACE_SWITCH = 3,         // lava/ice toggled
+    TRACE_MOVEMENT_ERROR = 4  // player left inside a block after resolution
+};
+
+// Why the vertical movement was zeroed in a tick, 0 if it was not. Swept
+// movement slides along walls, so STOP_BY_X is no longer recorded; it keeps
+// its value for older trace files
+enum Trace_Stop_Reason { STOP_NONE = 0, STOP_GROUND, STOP_HEAD, STOP_STANDING, STOP_BY_X };
+
+// One fixed-size trace record. Collision types tell which side of the
+// player met a block: 1 right/top, 3 left/bottom, 2 pushed out of a block it
+// already overlapped, 0 none
+struct TraceEvent {
+    unsigned long long tick;
+    float x;
+    float y;
+    float yMovement;
+    unsigned char type;
+    unsigned char xCollisionType;
+    unsigned char yCollisionType;
+    unsigned char stopReason;
+    unsigned char isGrounded;
+    unsigned char collision;
+    unsigned char state; // 'L' or 'I'
+    unsigned char padding;
+};
+
+// Fixed-capacity in-memory ring of the most recent trace events. record() is
+// wait-free: writers claim a slot with one atomic increment and overwrite the
+// oldest event, nothing is allocated or written to a stream in the loop.
+//
+// dump() writes the retained events oldest first as
+//     "ICYTRACE" | u32 version | u32 sizeof(TraceEvent) | u64 count | events
+// in host byte order. It is meant to run while no events are being recorded
+class TraceRing {
+public:
+    // capacity is rounded up to a power of two
+    // ------------------------------------------------------------------------
+    explicit TraceRing(size_t capacity = 1 << 16);
+
+    // runtime switch, a disabled ring ignores record()
+    // ------------------------------------------------------------------------
+    void setEnabled(bool enabled) { active.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+    // ------------------------------------------------------------------------
+    void record(const TraceEvent& event) {
+        unsigned long long slot = head.fetch_add(1, std::memory_order_relaxed);
+        events[slot & mask] = event;
+    }
+
+    // number of events currently retained
+    // ------------------------------------------------------------------------
+    size_t size() const;
+
+    // ------------------------------------------------------------------------
+    bool dump(const std::string& path) const;
+
+private:
+    std::vector<TraceEvent> events;
+    unsigned long long mask;
+    std::atomic<unsigned long long> head;
+    std::atomic<bool> active;
+};
+
+#endif // TRACE_HPP
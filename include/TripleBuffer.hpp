@@ -0,0 +1,50 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+
+// Lock-free hand over of the latest value from one writer thread to one
+// reader thread. The writer fills its back slot and publishes it by swapping
+// it with the middle slot; the reader swaps its front slot with the middle
+// one whenever a newer value is waiting. Neither side ever waits for the
+// other, the reader always sees a complete value, and values it was too
+// slow to pick up are simply skipped. A slot comes back to the writer with
+// an old value in it, which it overwrites
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : front(0), back(2), middle(1) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // writer only: the slot to fill, then publish() it
+    // ------------------------------------------------------------------------
+    T& writeSlot() { return slots[back]; }
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // reader only: takes over the newest published value if there is one,
+    // returns whether it did; read() stays valid until the next acquire()
+    // ------------------------------------------------------------------------
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& read() const { return slots[front]; }
+
+private:
+    // the middle slot's index, marked fresh while the reader has not seen it
+    static const unsigned int INDEX = 3;
+    static const unsigned int FRESH = 4;
+
+    T slots[3];
+    unsigned int front; // reader's slot
+    unsigned int back;  // writer's slot
+    std::atomic<unsigned int> middle;
+};
+
+#endif // TRIPLE_BUFFER_HPP
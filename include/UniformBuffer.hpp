@@ -0,0 +1,57 @@
+#ifndef UNIFORM_BUFFER_HPP
+#define UNIFORM_BUFFER_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Fixed binding points of the uniform blocks shared by all programs. Shaders
+// declare the blocks by name and Shader::bindUniformBlock attaches them here
+enum Uniform_Block_Binding { FRAME_BLOCK_BINDING = 0, LIGHT_BLOCK_BINDING = 1 };
+
+// std140 mirror of "FrameBlock": camera state, written once per frame
+struct FrameUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPos; // vec3 + float share one 16 byte slot in std140
+    float time;
+};
+static_assert(sizeof(FrameUniforms) == 144, "FrameUniforms must match std140");
+
+// std140 mirror of "LightBlock"; vec3 members are padded to vec4. The lamp
+// lights the whole level, the point lights are looked up in the grid that
+// LightGrid fills in
+struct LightUniforms {
+    glm::vec4 position;
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+    glm::vec2 gridOrigin; // world xy of the first cell's corner
+    glm::vec2 cellSize;
+    glm::ivec2 gridSize;  // cells; zero when no point light is visible
+    glm::vec2 gridDepth;  // z range the lights reach, the grid is flat
+    float brightness;     // scales every point light's colour
+    float padding[3];
+};
+static_assert(sizeof(LightUniforms) == 112, "LightUniforms must match std140");
+
+// A uniform buffer object bound to a fixed binding point for its whole
+// lifetime. update() replaces the contents with a single buffer upload
+class UniformBuffer {
+public:
+    UniformBuffer(GLuint binding, GLsizeiptr size);
+    ~UniformBuffer();
+
+    // ------------------------------------------------------------------------
+    void update(const void* data, GLsizeiptr size);
+
+    template <typename T> void update(const T& data) {
+        update(&data, sizeof(T));
+    }
+
+    GLuint ID;
+
+private:
+    GLsizeiptr size;
+};
+
+#endif // UNIFORM_BUFFER_HPP
@@ -2,10 +2,15 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float time;
+};
 
 void main()
 {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+}
@@ -2,36 +2,86 @@
 out vec4 FragColor;
 
 struct Material {
-    sampler2D diffuse;
+    sampler2DArray diffuse;
     vec3 specular;
     float shininess;
 };
 
-struct Light {
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+flat in float Layer;
+
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float time;
+};
+
+// the lamp lights everything; point lights are binned into a grid over the
+// level plane (see LightGrid) and only the lights of the fragment's cell are
+// evaluated
+layout (std140) uniform LightBlock {
     vec3 position;
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
-};
-
-in vec3 FragPos;
-in vec3 Normal;
-in vec2 TexCoords;
+    vec2 gridOrigin;
+    vec2 cellSize;
+    ivec2 gridSize;
+    vec2 gridDepth;
+    float brightness;
+} light;
 
-uniform vec3 viewPos;
 uniform Material material;
-uniform Light light;
+
+uniform samplerBuffer lights;       // per light: position and radius, colour
+uniform usamplerBuffer lightCells;  // per cell: first index and count
+uniform usamplerBuffer lightIndices;
+
+vec3 pointLights(vec3 albedo, vec3 norm, vec3 viewDir)
+{
+    vec3 result = vec3(0.0);
+    ivec2 cell = ivec2(floor((FragPos.xy - light.gridOrigin) / light.cellSize));
+    bool inside = all(greaterThanEqual(cell, ivec2(0))) && all(lessThan(cell, light.gridSize)) &&
+        FragPos.z >= light.gridDepth.x && FragPos.z <= light.gridDepth.y;
+    if (!inside)
+        return result;
+
+    uvec2 range = texelFetch(lightCells, cell.y * light.gridSize.x + cell.x).xy;
+    for (uint i = 0u; i < range.y; i++) {
+        int index = int(texelFetch(lightIndices, int(range.x + i)).r);
+        vec4 positionRadius = texelFetch(lights, 2 * index);
+        vec3 color = texelFetch(lights, 2 * index + 1).rgb * light.brightness;
+
+        // smooth falloff to zero at the radius
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float distance = length(toLight);
+        float falloff = clamp(1.0 - distance / positionRadius.w, 0.0, 1.0);
+        falloff *= falloff;
+
+        vec3 lightDir = toLight / max(distance, 0.0001);
+        float diff = max(dot(norm, lightDir), 0.0);
+        vec3 reflectDir = reflect(-lightDir, norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+        result += falloff * color * (diff * albedo + spec * material.specular);
+    }
+    return result;
+}
 
 void main()
 {
+    vec3 albedo = texture(material.diffuse, vec3(TexCoords, Layer)).rgb;
+
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
+    vec3 ambient = light.ambient * albedo;
 
     // diffuse
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(light.position - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
+    vec3 diffuse = light.diffuse * diff * albedo;
 
     // specular
     vec3 viewDir = normalize(viewPos - FragPos);
@@ -39,6 +89,6 @@ void main()
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     vec3 specular = light.specular * (spec * material.specular);
 
-    vec3 result = ambient + diffuse + specular;
+    vec3 result = ambient + diffuse + specular + pointLights(albedo, norm, viewDir);
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
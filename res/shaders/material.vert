@@ -2,20 +2,36 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 aModel; // per instance, locations 3-6
+layout (location = 7) in float aLayer; // per instance, texture array layer
+#ifndef UNIFORM_SCALE
+layout (location = 8) in mat3 aNormalMatrix; // per instance, locations 8-10
+#endif
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+flat out float Layer;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float time;
+};
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+#ifdef UNIFORM_SCALE
+    // rotation and uniform scale only: the model matrix itself keeps normals
+    // perpendicular, the fragment shader renormalizes
+    Normal = mat3(aModel) * aNormal;
+#else
+    Normal = aNormalMatrix * aNormal;
+#endif
     TexCoords = aTexCoords;
+    Layer = aLayer;
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,107 @@
+#include <AabbKernel.hpp>
+
+#include <cmath>
+
+#if ICYHOT_SIMD && defined(__SSE2__)
+#include <emmintrin.h>
+#define AABB_KERNEL_LANES 4
+#else
+#define AABB_KERNEL_LANES 1
+#endif
+
+void resolveTileContactsScalar(const AabbBatch& boxes, size_t first, const float* tileX,
+    const float* tileY, unsigned char* contacts) {
+    for (size_t i = first; i < boxes.count; i++) {
+        float dx = boxes.x[i] - tileX[i];
+        float dy = boxes.y[i] - tileY[i];
+        bool overlap = std::fabs(dx) < boxes.halfX[i] + 0.5f &&
+            std::fabs(dy) < boxes.halfY[i] + 0.5f;
+        bool wasClearY = boxes.previousY[i] - boxes.halfY[i] >= tileY[i] + 0.5f - CONTACT_EPSILON ||
+            boxes.previousY[i] + boxes.halfY[i] <= tileY[i] - 0.5f + CONTACT_EPSILON;
+        bool vertical = overlap && wasClearY;
+        bool sideways = overlap && !wasClearY;
+        float signX = dx > 0.0f ? 1.0f : -1.0f;
+        float signY = dy > 0.0f ? 1.0f : -1.0f;
+        boxes.y[i] = vertical ? tileY[i] + signY * (boxes.halfY[i] + 0.5f) : boxes.y[i];
+        boxes.velocityY[i] = vertical ? 0.0f : boxes.velocityY[i];
+        boxes.x[i] = sideways ? tileX[i] + signX * (boxes.halfX[i] + 0.5f) : boxes.x[i];
+        boxes.velocityX[i] = sideways ? -boxes.velocityX[i] : boxes.velocityX[i];
+        contacts[i] = static_cast<unsigned char>((overlap ? CONTACT_HIT : 0) |
+            (vertical && dy > 0.0f ? CONTACT_GROUND : 0));
+    }
+}
+
+#if AABB_KERNEL_LANES == 4
+
+// four boxes per instruction; every select is an and/andnot/or blend, so the
+// lanes never branch. Negating a velocity flips its sign bit, which is what
+// the scalar unary minus does as well
+// ------------------------------------------------------------------------
+void resolveTileContacts(const AabbBatch& boxes, const float* tileX, const float* tileY,
+    unsigned char* contacts) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 epsilon = _mm_set1_ps(CONTACT_EPSILON);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= boxes.count; i += 4) {
+        __m128 x = _mm_loadu_ps(boxes.x + i);
+        __m128 y = _mm_loadu_ps(boxes.y + i);
+        __m128 previousY = _mm_loadu_ps(boxes.previousY + i);
+        __m128 halfX = _mm_loadu_ps(boxes.halfX + i);
+        __m128 halfY = _mm_loadu_ps(boxes.halfY + i);
+        __m128 velocityX = _mm_loadu_ps(boxes.velocityX + i);
+        __m128 velocityY = _mm_loadu_ps(boxes.velocityY + i);
+        __m128 cellX = _mm_loadu_ps(tileX + i);
+        __m128 cellY = _mm_loadu_ps(tileY + i);
+
+        __m128 dx = _mm_sub_ps(x, cellX);
+        __m128 dy = _mm_sub_ps(y, cellY);
+        __m128 reachX = _mm_add_ps(halfX, half);
+        __m128 reachY = _mm_add_ps(halfY, half);
+        __m128 overlap = _mm_and_ps(_mm_cmplt_ps(_mm_andnot_ps(sign, dx), reachX),
+            _mm_cmplt_ps(_mm_andnot_ps(sign, dy), reachY));
+        __m128 above = _mm_cmpge_ps(_mm_sub_ps(previousY, halfY),
+            _mm_sub_ps(_mm_add_ps(cellY, half), epsilon));
+        __m128 below = _mm_cmple_ps(_mm_add_ps(previousY, halfY),
+            _mm_add_ps(_mm_sub_ps(cellY, half), epsilon));
+        __m128 wasClearY = _mm_or_ps(above, below);
+        __m128 vertical = _mm_and_ps(overlap, wasClearY);
+        __m128 sideways = _mm_andnot_ps(wasClearY, overlap);
+
+        // +1 or -1 by the side of the tile the box centre is on
+        __m128 positiveX = _mm_cmpgt_ps(dx, zero);
+        __m128 positiveY = _mm_cmpgt_ps(dy, zero);
+        __m128 signX = _mm_or_ps(one, _mm_andnot_ps(positiveX, sign));
+        __m128 signY = _mm_or_ps(one, _mm_andnot_ps(positiveY, sign));
+
+        __m128 pushedY = _mm_add_ps(cellY, _mm_mul_ps(signY, reachY));
+        __m128 pushedX = _mm_add_ps(cellX, _mm_mul_ps(signX, reachX));
+        _mm_storeu_ps(boxes.y + i,
+            _mm_or_ps(_mm_and_ps(vertical, pushedY), _mm_andnot_ps(vertical, y)));
+        _mm_storeu_ps(boxes.velocityY + i, _mm_andnot_ps(vertical, velocityY));
+        _mm_storeu_ps(boxes.x + i,
+            _mm_or_ps(_mm_and_ps(sideways, pushedX), _mm_andnot_ps(sideways, x)));
+        _mm_storeu_ps(boxes.velocityX + i, _mm_xor_ps(velocityX, _mm_and_ps(sideways, sign)));
+
+        int hit = _mm_movemask_ps(overlap);
+        int ground = _mm_movemask_ps(_mm_and_ps(vertical, positiveY));
+        for (int lane = 0; lane < 4; lane++)
+            contacts[i + lane] = static_cast<unsigned char>(((hit >> lane) & 1) * CONTACT_HIT |
+                ((ground >> lane) & 1) * CONTACT_GROUND);
+    }
+    resolveTileContactsScalar(boxes, i, tileX, tileY, contacts);
+}
+
+#else
+
+void resolveTileContacts(const AabbBatch& boxes, const float* tileX, const float* tileY,
+    unsigned char* contacts) {
+    resolveTileContactsScalar(boxes, 0, tileX, tileY, contacts);
+}
+
+#endif
+
+unsigned int tileContactLanes() { return AABB_KERNEL_LANES; }
@@ -0,0 +1,302 @@
+#include <BlockRenderer.hpp>
+
+#include <Profiler.hpp>
+
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// rotation times uniform scale: orthogonal basis columns of equal length
+bool isUniformScale(const glm::mat4& model) {
+    glm::vec3 x(model[0]), y(model[1]), z(model[2]);
+    float scale = glm::dot(x, x);
+    float tolerance = 1e-4f * scale;
+    return std::abs(glm::dot(y, y) - scale) <= tolerance &&
+        std::abs(glm::dot(z, z) - scale) <= tolerance &&
+        std::abs(glm::dot(x, y)) <= tolerance &&
+        std::abs(glm::dot(y, z)) <= tolerance &&
+        std::abs(glm::dot(z, x)) <= tolerance;
+}
+
+glm::mat3 normalMatrix(const glm::mat4& model) {
+    return glm::transpose(glm::inverse(glm::mat3(model)));
+}
+
+} // namespace
+
+BlockRenderer::BlockRenderer(const Mesh& mesh, unsigned int textureArray)
+    : mesh(&mesh), textureArray(textureArray),
+    instanceCapacity(0), dirty(true), lastDrawCalls(0), lastCulled(0), lastTriangles(0),
+    playerUniform(true), actorsUniform(true), dynamicChanged(false), dynamicCapacity(1) {
+    glGenBuffers(1, &instanceVBO);
+
+    dynamic.type = PLAYER;
+    dynamic.first = 0;
+    dynamic.chunk = -1;
+    resetBounds(dynamic);
+    Instance instance = { glm::mat4(1.0f), 0.0f, glm::mat3(1.0f) };
+    dynamic.instances.push_back(instance);
+    createVertexArray(dynamic);
+
+    for (unsigned int i = 0; i < BLOCK_TYPE_COUNT; i++)
+        visible[i] = true;
+}
+
+BlockRenderer::~BlockRenderer() {
+    for (size_t i = 0; i < batches.size(); i++)
+        glDeleteVertexArrays(1, &batches[i].VAO);
+    glDeleteVertexArrays(1, &dynamic.VAO);
+    glDeleteBuffers(1, &instanceVBO);
+}
+
+void BlockRenderer::clear() {
+    size_t kept = 0;
+    for (size_t i = 0; i < batches.size(); i++) {
+        if (batches[i].mesh) {
+            glDeleteVertexArrays(1, &batches[i].VAO);
+            continue;
+        }
+        batches[i].instances.clear();
+        resetBounds(batches[i]);
+        batches[kept++] = batches[i];
+    }
+    batches.resize(kept);
+    dirty = true;
+}
+
+void BlockRenderer::addBlock(Block_Type type, unsigned int layer,
+    const glm::vec3& position, float scale) {
+    Instance instance = { glm::mat4(1.0f), static_cast<float>(layer),
+        glm::mat3(1.0f / scale) };
+    instance.model[0][0] = instance.model[1][1] = instance.model[2][2] = scale;
+    instance.model[3] = glm::vec4(position, 1.0f);
+    Batch& batch = findBatch(type);
+    batch.instances.push_back(instance);
+    batch.boundsMin = glm::min(batch.boundsMin, position - glm::vec3(0.5f * scale));
+    batch.boundsMax = glm::max(batch.boundsMax, position + glm::vec3(0.5f * scale));
+    dirty = true;
+}
+
+void BlockRenderer::addStaticMesh(Block_Type type, unsigned int layer,
+    const MeshData& data, const glm::vec3& position, int chunk) {
+    if (data.indices.empty())
+        return;
+    Batch batch;
+    batch.type = type;
+    batch.first = 0;
+    batch.mesh = std::make_shared<Mesh>(data);
+    batch.chunk = chunk;
+    Instance instance = { glm::mat4(1.0f), static_cast<float>(layer),
+        glm::mat3(1.0f) };
+    instance.model[3] = glm::vec4(position, 1.0f);
+    batch.instances.push_back(instance);
+    resetBounds(batch);
+    for (size_t i = 0; i < data.vertices.size(); i++) {
+        batch.boundsMin = glm::min(batch.boundsMin, data.vertices[i].position + position);
+        batch.boundsMax = glm::max(batch.boundsMax, data.vertices[i].position + position);
+    }
+    createVertexArray(batch);
+    batches.push_back(batch);
+    dirty = true;
+}
+
+void BlockRenderer::removeChunk(int chunk) {
+    size_t kept = 0;
+    for (size_t i = 0; i < batches.size(); i++) {
+        if (batches[i].mesh && batches[i].chunk == chunk) {
+            glDeleteVertexArrays(1, &batches[i].VAO);
+            continue;
+        }
+        batches[kept++] = batches[i];
+    }
+    if (kept != batches.size()) {
+        batches.resize(kept);
+        dirty = true;
+    }
+}
+
+void BlockRenderer::setVisible(Block_Type type, bool isVisible) {
+    visible[type] = isVisible;
+}
+
+void BlockRenderer::setPlayer(const glm::mat4& model, unsigned int layer) {
+    dynamic.instances[0].model = model;
+    dynamic.instances[0].layer = static_cast<float>(layer);
+    dynamic.instances[0].normal = normalMatrix(model);
+    playerUniform = isUniformScale(model);
+    dynamicChanged = true;
+}
+
+// straight loops over the components: every actor is an axis aligned box, so
+// the model matrix is a scale and translation and its normal matrix the
+// inverse scale, and nothing depends on the kind but two table lookups
+// ------------------------------------------------------------------------
+void BlockRenderer::setActors(const ActorSnapshot& actors, float alpha,
+    const unsigned int* kindLayers, const unsigned int* kindFrames) {
+    size_t count = actors.size();
+    dynamic.instances.resize(1 + count);
+    bool uniform = true;
+    for (size_t i = 0; i < count; i++) {
+        Instance& instance = dynamic.instances[1 + i];
+        float sizeX = 2.0f * actors.halfX[i];
+        float sizeY = 2.0f * actors.halfY[i];
+        instance.model = glm::mat4(1.0f);
+        instance.model[0][0] = sizeX;
+        instance.model[1][1] = sizeY;
+        instance.model[2][2] = sizeY;
+        instance.model[3][0] = actors.previousX[i] + (actors.x[i] - actors.previousX[i]) * alpha;
+        instance.model[3][1] = actors.previousY[i] + (actors.y[i] - actors.previousY[i]) * alpha;
+        unsigned int kind = actors.kind[i];
+        instance.layer = static_cast<float>(kindLayers[kind] +
+            actors.frame[i] / 20 % kindFrames[kind]);
+        instance.normal = glm::mat3(1.0f);
+        instance.normal[0][0] = 1.0f / sizeX;
+        instance.normal[1][1] = 1.0f / sizeY;
+        instance.normal[2][2] = 1.0f / sizeY;
+        uniform &= sizeX == sizeY;
+    }
+    actorsUniform = uniform;
+    dynamicChanged = true;
+
+    // grow the reserved range geometrically; only then is the layout redone
+    if (dynamic.instances.size() > dynamicCapacity) {
+        while (dynamicCapacity < dynamic.instances.size())
+            dynamicCapacity *= 2;
+        dirty = true;
+    }
+}
+
+bool BlockRenderer::uniformScale() const { return playerUniform && actorsUniform; }
+
+void BlockRenderer::draw(const Frustum& frustum) {
+    if (dirty)
+        upload();
+    else if (dynamicChanged)
+        uploadDynamic();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+    Profiler::count(COUNTER_TEXTURE_BINDS);
+
+    lastDrawCalls = 0;
+    lastCulled = 0;
+    lastTriangles = 0;
+    for (size_t i = 0; i <= batches.size(); i++) {
+        Batch& batch = i < batches.size() ? batches[i] : dynamic;
+        if (!visible[batch.type] || batch.instances.empty())
+            continue;
+        if (&batch != &dynamic &&
+            !frustum.intersects(batch.boundsMin, batch.boundsMax)) {
+            lastCulled++;
+            continue;
+        }
+        const Mesh& batchMesh = meshOf(batch);
+        glBindVertexArray(batch.VAO);
+        Profiler::count(COUNTER_STATE_CHANGES);
+        batchMesh.drawInstanced(static_cast<GLsizei>(batch.instances.size()));
+        lastDrawCalls++;
+        lastTriangles += batchMesh.indexCount() / 3 *
+            static_cast<unsigned int>(batch.instances.size());
+    }
+}
+
+BlockRenderer::Batch& BlockRenderer::findBatch(Block_Type type) {
+    for (size_t i = 0; i < batches.size(); i++) {
+        if (batches[i].type == type && !batches[i].mesh)
+            return batches[i];
+    }
+    Batch batch;
+    batch.type = type;
+    batch.first = 0;
+    batch.chunk = -1;
+    resetBounds(batch);
+    createVertexArray(batch);
+    batches.push_back(batch);
+    return batches.back();
+}
+
+// per-vertex mesh attributes and indices, shared by every batch that has no
+// merged mesh of its own
+// ------------------------------------------------------------------------
+void BlockRenderer::createVertexArray(Batch& batch) {
+    glGenVertexArrays(1, &batch.VAO);
+    glBindVertexArray(batch.VAO);
+    meshOf(batch).bindAttributes();
+    glBindVertexArray(0);
+}
+
+const Mesh& BlockRenderer::meshOf(const Batch& batch) const {
+    return batch.mesh ? *batch.mesh : *mesh;
+}
+
+void BlockRenderer::resetBounds(Batch& batch) {
+    batch.boundsMin = glm::vec3(FLT_MAX);
+    batch.boundsMax = glm::vec3(-FLT_MAX);
+}
+
+// lays out all batches back to back in one buffer and points every batch's
+// instance attributes at its own range
+// ------------------------------------------------------------------------
+void BlockRenderer::upload() {
+    unsigned int total = 0;
+    for (size_t i = 0; i < batches.size(); i++) {
+        batches[i].first = total;
+        total += static_cast<unsigned int>(batches[i].instances.size());
+    }
+    dynamic.first = total;
+    total += dynamicCapacity;
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (total > instanceCapacity) {
+        glBufferData(GL_ARRAY_BUFFER, total * sizeof(Instance), nullptr,
+            GL_STATIC_DRAW);
+        instanceCapacity = total;
+    }
+    for (size_t i = 0; i <= batches.size(); i++) {
+        Batch& batch = i < batches.size() ? batches[i] : dynamic;
+        if (!batch.instances.empty())
+            glBufferSubData(GL_ARRAY_BUFFER, batch.first * sizeof(Instance),
+                batch.instances.size() * sizeof(Instance), &batch.instances[0]);
+        bindInstanceAttributes(batch);
+    }
+    glBindVertexArray(0);
+
+    dirty = false;
+    dynamicChanged = false;
+}
+
+void BlockRenderer::uploadDynamic() {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, dynamic.first * sizeof(Instance),
+        dynamic.instances.size() * sizeof(Instance), &dynamic.instances[0]);
+    dynamicChanged = false;
+}
+
+// a mat4 attribute takes four consecutive vec4 locations (3..6), the layer
+// follows at 7 and the mat3 normal matrix takes three vec3 locations (8..10)
+// ------------------------------------------------------------------------
+void BlockRenderer::bindInstanceAttributes(Batch& batch) {
+    glBindVertexArray(batch.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    size_t base = batch.first * sizeof(Instance);
+    for (unsigned int column = 0; column < 4; column++) {
+        GLuint location = 3 + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+            (void*)(base + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(Instance),
+        (void*)(base + sizeof(glm::mat4)));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+    for (unsigned int column = 0; column < 3; column++) {
+        GLuint location = 8 + column;
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(Instance),
+            (void*)(base + sizeof(glm::mat4) + sizeof(float) +
+                column * sizeof(glm::vec3)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+}
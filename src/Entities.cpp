@@ -0,0 +1,283 @@
+#include <Entities.hpp>
+
+#include <AabbKernel.hpp>
+
+#include <cmath>
+
+namespace {
+
+struct Kind_Defaults {
+    float halfX;
+    float halfY;
+    float gravity;
+    unsigned char flags;
+};
+
+// enemies walk and fall like the player and turn at walls, platforms glide
+// between walls and carry the player, projectiles fly straight until they
+// hit something
+const Kind_Defaults KIND_DEFAULTS[ENTITY_KIND_COUNT] = {
+    { 0.375f, 0.375f, ENTITY_GRAVITY, ENTITY_HARMFUL },
+    { 1.5f, 0.25f, 0.0f, ENTITY_CARRIES },
+    { 0.2f, 0.2f, 0.0f, ENTITY_HARMFUL | ENTITY_DIES_ON_HIT }
+};
+
+// blocks resolved per entity and tick: the floor, then a wall or ceiling
+const int RESOLVE_PASSES = 3;
+
+// faces a swept entity can stop against in one step: the floor or ceiling
+// and a wall, after which both axes are blocked
+const int SWEEP_CONTACTS = 2;
+
+int cellOf(float coordinate) {
+    return static_cast<int>(std::floor(coordinate + 0.5f));
+}
+
+} // namespace
+
+void EntityStore::clear() {
+    x.clear();
+    y.clear();
+    previousX.clear();
+    previousY.clear();
+    velocityX.clear();
+    velocityY.clear();
+    halfX.clear();
+    halfY.clear();
+    gravity.clear();
+    kind.clear();
+    flags.clear();
+    frame.clear();
+}
+
+void EntityStore::spawn(Entity_Kind entityKind, const glm::vec2& position,
+    const glm::vec2& velocity) {
+    const Kind_Defaults& defaults = KIND_DEFAULTS[entityKind];
+    x.push_back(position.x);
+    y.push_back(position.y);
+    previousX.push_back(position.x);
+    previousY.push_back(position.y);
+    velocityX.push_back(velocity.x);
+    velocityY.push_back(velocity.y);
+    halfX.push_back(defaults.halfX);
+    halfY.push_back(defaults.halfY);
+    gravity.push_back(defaults.gravity);
+    kind.push_back(static_cast<unsigned char>(entityKind));
+    flags.push_back(defaults.flags);
+    frame.push_back(0);
+}
+
+void EntityStore::step(const TileMap& tiles, unsigned char layers, unsigned int ticks) {
+    integrate(tiles, layers, ticks);
+    collide(tiles, layers);
+    animate(ticks);
+    compact();
+}
+
+void EntityStore::snapshot(ActorSnapshot& out) const {
+    out.x.assign(x.begin(), x.end());
+    out.y.assign(y.begin(), y.end());
+    out.previousX.assign(previousX.begin(), previousX.end());
+    out.previousY.assign(previousY.begin(), previousY.end());
+    out.halfX.assign(halfX.begin(), halfX.end());
+    out.halfY.assign(halfY.begin(), halfY.end());
+    out.kind.assign(kind.begin(), kind.end());
+    out.frame.assign(frame.begin(), frame.end());
+}
+
+bool EntityStore::touchesHarmful(const glm::vec2& min, const glm::vec2& max) const {
+    bool touches = false;
+    for (size_t i = 0; i < x.size(); i++) {
+        bool overlaps = min.x < x[i] + halfX[i] && max.x > x[i] - halfX[i] &&
+            min.y < y[i] + halfY[i] && max.y > y[i] - halfY[i];
+        touches |= overlaps && (flags[i] & ENTITY_HARMFUL);
+    }
+    return touches;
+}
+
+int EntityStore::support(const glm::vec2& min, const glm::vec2& max, float fall) const {
+    for (size_t i = 0; i < x.size(); i++) {
+        if (!(flags[i] & ENTITY_CARRIES))
+            continue;
+        // how far the box fell relative to this entity's top
+        float top = y[i] + halfY[i];
+        float relativeFall = fall + y[i] - previousY[i];
+        if (min.x < x[i] + halfX[i] && max.x > x[i] - halfX[i] &&
+            min.y <= top + CONTACT_EPSILON &&
+            min.y + relativeFall + CONTACT_EPSILON >= top)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// entities outside resident chunks keep still (awake is 0) rather than fall
+// through collision that is not loaded; leaving the level kills them.
+// Each entity sweeps the straight line to where that many single ticks of
+// free flight would take it against the tile grid and stops at the first
+// face it reaches, placed exactly against it: a floor or ceiling ends its
+// vertical motion, a wall turns it around, and the rest of the step slides
+// along the free axis. The sweep also sees the blocks an entity already
+// overlaps, and only those entities are left to collide
+// ------------------------------------------------------------------------
+void EntityStore::integrate(const TileMap& tiles, unsigned char layers, unsigned int ticks) {
+    float steps = static_cast<float>(ticks);
+    unresolved.clear();
+    for (size_t i = 0; i < x.size(); i++) {
+        int cellX = cellOf(x[i]);
+        int cellY = cellOf(y[i]);
+        float awake = tiles.resident(cellX, cellY) ? steps : 0.0f;
+        previousX[i] = x[i];
+        previousY[i] = y[i];
+        flags[i] &= ~ENTITY_GROUNDED;
+
+        // awake ticks of falling in closed form: each tick first accelerates
+        // and then moves, so the fall is gravity * (1 + 2 + ... + awake)
+        float fall = gravity[i] * awake * (awake + 1.0f) * 0.5f;
+        glm::vec2 center(x[i], y[i]);
+        glm::vec2 half(halfX[i], halfY[i]);
+        glm::vec2 delta(velocityX[i] * awake, velocityY[i] * awake - fall);
+        velocityY[i] -= gravity[i] * awake;
+        bool overlapping = false;
+        for (int contact = 0; contact < SWEEP_CONTACTS; contact++) {
+            Tile_Sweep hit = tiles.sweep(center, half, delta, layers);
+            overlapping |= hit.overlapping;
+            center += delta * hit.time;
+            if (hit.time >= 1.0f)
+                break;
+            delta *= 1.0f - hit.time;
+            if (hit.normal.x != 0.0f) {
+                center.x = static_cast<float>(hit.cell.x) + hit.normal.x * (half.x + 0.5f);
+                velocityX[i] = -velocityX[i];
+                delta.x = 0.0f;
+            } else {
+                center.y = static_cast<float>(hit.cell.y) + hit.normal.y * (half.y + 0.5f);
+                velocityY[i] = 0.0f;
+                delta.y = 0.0f;
+                flags[i] |= hit.normal.y > 0.0f ? ENTITY_GROUNDED : 0;
+            }
+            flags[i] |= (flags[i] & ENTITY_DIES_ON_HIT) ? ENTITY_DEAD : 0;
+        }
+        x[i] = center.x;
+        y[i] = center.y;
+        flags[i] |= tiles.contains(cellOf(center.x), cellOf(center.y)) ? 0 : ENTITY_DEAD;
+        if (overlapping)
+            unresolved.push_back(static_cast<unsigned int>(i));
+    }
+}
+
+// pushes out what the sweep left overlapping: entities spawned inside
+// blocks, or with blocks switched on around them. Each pass looks up the
+// first block every such entity overlaps, packs them into contiguous
+// arrays and resolves them with the batched kernel (see
+// resolveTileContacts); the ones that were pushed out are looked up again,
+// since an entity in a corner overlaps the floor first and a wall next
+// ------------------------------------------------------------------------
+void EntityStore::collide(const TileMap& tiles, unsigned char layers) {
+    for (int pass = 0; pass < RESOLVE_PASSES && !unresolved.empty(); pass++) {
+        packed.resize(unresolved.size());
+        size_t packedCount = 0;
+        for (size_t k = 0; k < unresolved.size(); k++) {
+            unsigned int i = unresolved[k];
+            int cellX = 0, cellY = 0;
+            if (tiles.firstOverlap(glm::vec2(x[i] - halfX[i], y[i] - halfY[i]),
+                    glm::vec2(x[i] + halfX[i], y[i] + halfY[i]), layers, cellX, cellY))
+                packed.set(packedCount++, *this, i, static_cast<float>(cellX),
+                    static_cast<float>(cellY));
+        }
+        if (packedCount == 0)
+            break;
+
+        AabbBatch packedBoxes = { packedCount, packed.x.data(), packed.y.data(),
+            packed.previousY.data(), packed.halfX.data(), packed.halfY.data(),
+            packed.velocityX.data(), packed.velocityY.data() };
+        resolveTileContacts(packedBoxes, packed.tileX.data(), packed.tileY.data(),
+            packed.contacts.data());
+
+        unresolved.clear();
+        for (size_t k = 0; k < packedCount; k++) {
+            unsigned int i = packed.entity[k];
+            x[i] = packed.x[k];
+            y[i] = packed.y[k];
+            velocityX[i] = packed.velocityX[k];
+            velocityY[i] = packed.velocityY[k];
+            applyContact(i, packed.contacts[k]);
+            if (packed.contacts[k] & CONTACT_HIT)
+                unresolved.push_back(i);
+        }
+    }
+}
+
+void EntityStore::applyContact(size_t index, unsigned char contact) {
+    flags[index] |= (contact & CONTACT_GROUND) ? ENTITY_GROUNDED : 0;
+    flags[index] |= (contact & CONTACT_HIT) && (flags[index] & ENTITY_DIES_ON_HIT) ?
+        ENTITY_DEAD : 0;
+}
+
+void EntityStore::PackedBoxes::resize(size_t count) {
+    entity.resize(count);
+    x.resize(count);
+    y.resize(count);
+    previousY.resize(count);
+    halfX.resize(count);
+    halfY.resize(count);
+    velocityX.resize(count);
+    velocityY.resize(count);
+    tileX.resize(count);
+    tileY.resize(count);
+    contacts.resize(count);
+}
+
+void EntityStore::PackedBoxes::set(size_t slot, const EntityStore& store, unsigned int index,
+    float cellX, float cellY) {
+    entity[slot] = index;
+    x[slot] = store.x[index];
+    y[slot] = store.y[index];
+    previousY[slot] = store.previousY[index];
+    halfX[slot] = store.halfX[index];
+    halfY[slot] = store.halfY[index];
+    velocityX[slot] = store.velocityX[index];
+    velocityY[slot] = store.velocityY[index];
+    tileX[slot] = cellX;
+    tileY[slot] = cellY;
+}
+
+// same 80 tick cycle as the player's animation
+void EntityStore::animate(unsigned int ticks) {
+    for (size_t i = 0; i < frame.size(); i++)
+        frame[i] = static_cast<unsigned short>((frame[i] + ticks) % 80);
+}
+
+void EntityStore::compact() {
+    for (size_t i = x.size(); i-- > 0;) {
+        if (flags[i] & ENTITY_DEAD)
+            remove(i);
+    }
+}
+
+void EntityStore::remove(size_t index) {
+    size_t last = x.size() - 1;
+    x[index] = x[last];
+    y[index] = y[last];
+    previousX[index] = previousX[last];
+    previousY[index] = previousY[last];
+    velocityX[index] = velocityX[last];
+    velocityY[index] = velocityY[last];
+    halfX[index] = halfX[last];
+    halfY[index] = halfY[last];
+    gravity[index] = gravity[last];
+    kind[index] = kind[last];
+    flags[index] = flags[last];
+    frame[index] = frame[last];
+    x.pop_back();
+    y.pop_back();
+    previousX.pop_back();
+    previousY.pop_back();
+    velocityX.pop_back();
+    velocityY.pop_back();
+    halfX.pop_back();
+    halfY.pop_back();
+    gravity.pop_back();
+    kind.pop_back();
+    flags.pop_back();
+    frame.pop_back();
+}
@@ -0,0 +1,81 @@
+#include <FileWatcher.hpp>
+
+#include <MappedFile.hpp>
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+FileWatcher::FileWatcher() : fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+
+FileWatcher::~FileWatcher() {
+    if (fd >= 0)
+        close(fd);
+}
+#else
+FileWatcher::FileWatcher() {}
+
+FileWatcher::~FileWatcher() {}
+#endif
+
+void FileWatcher::watch(const std::string& path) {
+    Stamp stamp = { 0, 0 };
+    fileStamp(path, stamp.size, stamp.modified);
+    files[path] = stamp;
+
+#ifdef __linux__
+    if (fd < 0)
+        return;
+    // editors often save by writing a temporary file and renaming it over
+    // the original, so the directory is watched rather than the file
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+    int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd >= 0)
+        directories[wd] = slash == std::string::npos ? "" : directory + "/";
+#endif
+}
+
+bool FileWatcher::poll(std::vector<std::string>& changed) {
+    size_t first = changed.size();
+#ifdef __linux__
+    if (fd >= 0) {
+        alignas(struct inotify_event) char buffer[4096];
+        for (;;) {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;
+            for (char* event = buffer; event < buffer + length;) {
+                const struct inotify_event* info =
+                    reinterpret_cast<const struct inotify_event*>(event);
+                std::map<int, std::string>::const_iterator directory =
+                    directories.find(info->wd);
+                if (info->len > 0 && directory != directories.end()) {
+                    std::string path = directory->second + info->name;
+                    if (files.count(path) &&
+                        std::find(changed.begin() + first, changed.end(), path) ==
+                        changed.end())
+                        changed.push_back(path);
+                }
+                event += sizeof(struct inotify_event) + info->len;
+            }
+        }
+        return changed.size() > first;
+    }
+#endif
+    for (std::map<std::string, Stamp>::iterator file = files.begin();
+        file != files.end(); ++file) {
+        Stamp stamp = { 0, 0 };
+        if (!fileStamp(file->first, stamp.size, stamp.modified))
+            continue;
+        if (stamp.size != file->second.size || stamp.modified != file->second.modified) {
+            file->second = stamp;
+            changed.push_back(file->first);
+        }
+    }
+    return changed.size() > first;
+}
@@ -0,0 +1,69 @@
+#include <Framebuffer.hpp>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <iostream>
+
+Framebuffer::Framebuffer(int width, int height)
+    : frameWidth(width), frameHeight(height) {
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+        GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &ID);
+    glBindFramebuffer(GL_FRAMEBUFFER, ID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+        colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+        depthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    isComplete = status == GL_FRAMEBUFFER_COMPLETE;
+    if (!isComplete)
+        std::cout << "ERROR::FRAMEBUFFER::NOT_COMPLETE status 0x" << std::hex
+            << status << std::dec << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+Framebuffer::~Framebuffer() {
+    glDeleteFramebuffers(1, &ID);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteTextures(1, &colorTexture);
+}
+
+void Framebuffer::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, ID);
+    glViewport(0, 0, frameWidth, frameHeight);
+}
+
+void Framebuffer::readPixels(std::vector<unsigned char>& pixels) const {
+    pixels.resize(static_cast<size_t>(frameWidth) * frameHeight * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, ID);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, frameWidth, frameHeight, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+}
+
+// GL rows run bottom up, image files top down
+// ---------------------------------------------------------------------------------------------
+bool Framebuffer::capture(const std::string& path) const {
+    std::vector<unsigned char> pixels;
+    readPixels(pixels);
+    stbi_flip_vertically_on_write(1);
+    int written = stbi_write_png(path.c_str(), frameWidth, frameHeight, 4, &pixels[0],
+        frameWidth * 4);
+    stbi_flip_vertically_on_write(0);
+    if (!written) {
+        std::cout << "ERROR::FRAMEBUFFER::CAPTURE_NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+    return true;
+}
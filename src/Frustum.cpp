@@ -0,0 +1,35 @@
+#include <Frustum.hpp>
+
+// everything is inside until a matrix is extracted
+Frustum::Frustum() {
+    for (int i = 0; i < 6; i++)
+        planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+// each plane is the fourth row of the matrix plus or minus one of the other
+// rows: left, right, bottom, top, near, far. glm is column major, so row r
+// is (m[0][r], m[1][r], m[2][r], m[3][r])
+// ------------------------------------------------------------------------
+void Frustum::extract(const glm::mat4& viewProjection) {
+    glm::mat4 rows = glm::transpose(viewProjection);
+    for (int i = 0; i < 3; i++) {
+        planes[2 * i] = rows[3] + rows[i];
+        planes[2 * i + 1] = rows[3] - rows[i];
+    }
+    for (int i = 0; i < 6; i++)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+// only the box corner furthest along the plane normal needs testing
+// ------------------------------------------------------------------------
+bool Frustum::intersects(const glm::vec3& min, const glm::vec3& max) const {
+    for (int i = 0; i < 6; i++) {
+        const glm::vec4& plane = planes[i];
+        glm::vec3 corner(plane.x >= 0.0f ? max.x : min.x,
+            plane.y >= 0.0f ? max.y : min.y,
+            plane.z >= 0.0f ? max.z : min.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
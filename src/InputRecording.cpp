@@ -0,0 +1,108 @@
+#include <InputRecording.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool saveRecording(const std::string& path, const std::vector<TickInput>& inputs) {
+    std::ofstream file(path.c_str());
+    if (!file) {
+        std::cout << "ERROR::RECORDING::FILE_NOT_SUCCESFULLY_WRITTEN " << path
+            << std::endl;
+        return false;
+    }
+
+    file << "# IcyHot input recording: <ticks> <x> <events>\n";
+    size_t i = 0;
+    while (i < inputs.size()) {
+        // a run continues while the direction holds and no new event fires
+        size_t run = 1;
+        while (i + run < inputs.size() && inputs[i + run].x == inputs[i].x &&
+            inputs[i + run].events == 0)
+            run++;
+
+        std::string events;
+        if (inputs[i].events & JUMP_EVENT)
+            events += 'J';
+        if (inputs[i].events & RESET_EVENT)
+            events += 'R';
+        if (inputs[i].events & SWITCH_EVENT)
+            events += 'S';
+        if (events.empty())
+            events = "-";
+
+        file << run << ' ' << static_cast<int>(inputs[i].x) << ' ' << events
+            << '\n';
+        i += run;
+    }
+    return true;
+}
+
+bool loadRecording(const std::string& path, std::vector<TickInput>& inputs) {
+    std::ifstream file(path.c_str());
+    if (!file) {
+        std::cout << "ERROR::RECORDING::FILE_NOT_SUCCESFULLY_READ " << path
+            << std::endl;
+        return false;
+    }
+
+    inputs.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        unsigned long ticks = 0;
+        int x = 0;
+        std::string events;
+        if (!(fields >> ticks >> x >> events) || x < -1 || x > 1) {
+            std::cout << "ERROR::RECORDING::PARSE_ERROR " << path << ":"
+                << lineNumber << std::endl;
+            return false;
+        }
+
+        TickInput input;
+        input.x = static_cast<signed char>(x);
+        input.events = 0;
+        for (size_t c = 0; c < events.size(); c++) {
+            if (events[c] == 'J')
+                input.events |= JUMP_EVENT;
+            else if (events[c] == 'R')
+                input.events |= RESET_EVENT;
+            else if (events[c] == 'S')
+                input.events |= SWITCH_EVENT;
+        }
+
+        for (unsigned long t = 0; t < ticks; t++) {
+            inputs.push_back(input);
+            input.events = 0;
+        }
+    }
+    return true;
+}
+
+std::vector<TickInput> scriptedInput(size_t ticks, unsigned int seed) {
+    std::vector<TickInput> inputs;
+    inputs.reserve(ticks);
+    while (inputs.size() < ticks) {
+        seed = seed * 1664525u + 1013904223u;
+        unsigned int run = 30 + (seed >> 8) % 170;
+        TickInput input;
+        input.x = static_cast<signed char>(static_cast<int>((seed >> 4) % 3) - 1);
+        input.events = 0;
+        if ((seed >> 12) % 2)
+            input.events |= JUMP_EVENT;
+        if ((seed >> 16) % 5 == 0)
+            input.events |= SWITCH_EVENT;
+        if ((seed >> 20) % 50 == 0)
+            input.events |= RESET_EVENT;
+        for (unsigned int t = 0; t < run && inputs.size() < ticks; t++) {
+            inputs.push_back(input);
+            input.events = 0;
+        }
+    }
+    return inputs;
+}
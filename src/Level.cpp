@@ -0,0 +1,323 @@
+#include <Level.hpp>
+
+#include <MappedFile.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool parseLevelText(const std::string& path, Level& level) {
+    std::ifstream file(path.c_str());
+    if (!file) {
+        std::cout << "ERROR::LEVEL::FILE_NOT_SUCCESFULLY_READ " << path
+            << std::endl;
+        return false;
+    }
+
+    level.playerStart = glm::vec3(0.0f);
+    level.tiles.clear();
+    level.backgrounds.clear();
+    level.actors.clear();
+
+    int originX = 0, originY = 0;
+    bool inMap = false;
+    int row = 0;
+    int lineNumber = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+
+        if (inMap) {
+            if (line == "end") {
+                inMap = false;
+                continue;
+            }
+            int y = originY - row;
+            for (size_t column = 0; column < line.size(); column++) {
+                int x = originX + static_cast<int>(column);
+                Tile tile = { x, y, STONE };
+                switch (line[column]) {
+                case '#': tile.type = STONE; break;
+                case 'F': tile.type = FINISH; break;
+                case 'L': tile.type = LAVA; break;
+                case 'I': tile.type = ICE; break;
+                case 'P':
+                    level.playerStart = glm::vec3(static_cast<float>(x),
+                        static_cast<float>(y), 0.0f);
+                    continue;
+                default:
+                    continue;
+                }
+                level.tiles.push_back(tile);
+            }
+            row++;
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string keyword;
+        if (!(fields >> keyword) || keyword[0] == '#')
+            continue;
+
+        bool valid = true;
+        if (keyword == "origin") {
+            valid = static_cast<bool>(fields >> originX >> originY);
+        }
+        else if (keyword == "background") {
+            glm::vec3 position;
+            valid = static_cast<bool>(fields >> position.x >> position.y >> position.z);
+            if (valid)
+                level.backgrounds.push_back(position);
+        }
+        else if (keyword == "actor") {
+            std::string kind;
+            ActorSpawn actor;
+            valid = static_cast<bool>(fields >> kind >> actor.position[0] >>
+                actor.position[1] >> actor.velocity[0] >> actor.velocity[1]);
+            if (kind == "enemy")
+                actor.kind = ENEMY;
+            else if (kind == "platform")
+                actor.kind = PLATFORM;
+            else if (kind == "projectile")
+                actor.kind = PROJECTILE;
+            else
+                valid = false;
+            if (valid)
+                level.actors.push_back(actor);
+        }
+        else if (keyword == "map") {
+            inMap = true;
+            row = 0;
+        }
+        else {
+            valid = false;
+        }
+
+        if (!valid) {
+            std::cout << "ERROR::LEVEL::PARSE_ERROR " << path << ":" << lineNumber
+                << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool writeLevelBinary(const std::string& path, const Level& level,
+    uint64_t sourceHash) {
+    int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+    for (size_t i = 0; i < level.tiles.size(); i++) {
+        minX = std::min(minX, level.tiles[i].x);
+        minY = std::min(minY, level.tiles[i].y);
+        maxX = std::max(maxX, level.tiles[i].x);
+        maxY = std::max(maxY, level.tiles[i].y);
+    }
+    if (level.tiles.empty())
+        minX = minY = 0, maxX = maxY = -1;
+
+    LevelFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "ICYLEVEL", 8);
+    header.version = LEVEL_FILE_VERSION;
+    header.backgroundCount = static_cast<uint32_t>(level.backgrounds.size());
+    header.actorCount = static_cast<uint32_t>(level.actors.size());
+    header.originX = minX;
+    header.originY = minY;
+    header.width = static_cast<uint32_t>(maxX - minX + 1);
+    header.height = static_cast<uint32_t>(maxY - minY + 1);
+    header.playerStart[0] = level.playerStart.x;
+    header.playerStart[1] = level.playerStart.y;
+    header.playerStart[2] = level.playerStart.z;
+    header.sourceHash = sourceHash;
+
+    const size_t chunkCells = TILE_CHUNK_SIZE * TILE_CHUNK_SIZE;
+    size_t chunkColumns = (header.width + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+    size_t chunkRows = (header.height + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+    std::vector<unsigned char> cells(chunkColumns * chunkRows * chunkCells, 0);
+    for (size_t i = 0; i < level.tiles.size(); i++) {
+        const Tile& tile = level.tiles[i];
+        size_t x = tile.x - minX, y = tile.y - minY;
+        size_t chunk = (y / TILE_CHUNK_SIZE) * chunkColumns + x / TILE_CHUNK_SIZE;
+        cells[chunk * chunkCells + (y % TILE_CHUNK_SIZE) * TILE_CHUNK_SIZE +
+            x % TILE_CHUNK_SIZE] = static_cast<unsigned char>(tile.type + 1);
+    }
+
+    // LevelFile maps the compiled file, possibly in another instance, so it
+    // is replaced as a whole rather than rewritten in place
+    const FilePart parts[] = {
+        { &header, sizeof(header) },
+        { level.backgrounds.empty() ? nullptr : &level.backgrounds[0][0],
+            level.backgrounds.size() * 3 * sizeof(float) },
+        { level.actors.empty() ? nullptr : &level.actors[0],
+            level.actors.size() * sizeof(ActorSpawn) },
+        { cells.empty() ? nullptr : &cells[0], cells.size() }
+    };
+    return replaceFile(path, parts, sizeof(parts) / sizeof(parts[0]));
+}
+
+namespace {
+
+size_t chunkCount(uint32_t cells) {
+    return (cells + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+}
+
+const LevelFileHeader* mappedHeader(const MappedFile& file) {
+    if (file.size() < sizeof(LevelFileHeader))
+        return nullptr;
+    const LevelFileHeader* header =
+        reinterpret_cast<const LevelFileHeader*>(file.data());
+    if (std::memcmp(header->magic, "ICYLEVEL", 8) != 0 ||
+        header->version != LEVEL_FILE_VERSION)
+        return nullptr;
+    size_t expected = sizeof(LevelFileHeader) +
+        header->backgroundCount * 3 * sizeof(float) +
+        header->actorCount * sizeof(ActorSpawn) +
+        chunkCount(header->width) * chunkCount(header->height) *
+        TILE_CHUNK_SIZE * TILE_CHUNK_SIZE;
+    return file.size() == expected ? header : nullptr;
+}
+
+// whether the compiled cache was built from the source with this hash
+bool compiledIsCurrent(const std::string& compiledPath, unsigned long long sourceHash) {
+    MappedFile cache;
+    if (!cache.open(compiledPath))
+        return false;
+    const LevelFileHeader* header = mappedHeader(cache);
+    return header && header->sourceHash == sourceHash;
+}
+
+} // namespace
+
+bool readLevelBinary(const std::string& path, Level& level) {
+    LevelFile file;
+    if (!file.open(path))
+        return false;
+
+    level.playerStart = file.playerStart();
+    file.backgrounds(level.backgrounds);
+    file.actors(level.actors);
+    level.tiles.clear();
+    glm::ivec2 first = file.origin();
+    glm::ivec2 last = first + glm::ivec2(file.chunksX(), file.chunksY()) * TILE_CHUNK_SIZE - 1;
+    file.tiles(first, last, level.tiles);
+    return true;
+}
+
+bool compileLevel(const std::string& path, std::string& compiledPath) {
+    const std::string extension(".lvl");
+    if (path.size() < extension.size() ||
+        path.compare(path.size() - extension.size(), extension.size(), extension) != 0) {
+        compiledPath = path;
+        return true;
+    }
+
+    unsigned long long sourceHash = 0;
+    if (!fileHash(path, sourceHash)) {
+        std::cout << "ERROR::LEVEL::FILE_NOT_SUCCESFULLY_READ " << path
+            << std::endl;
+        return false;
+    }
+
+    // keep the compiled cache if it was built from this exact source
+    compiledPath = cachePath(path, ".bin");
+    if (compiledIsCurrent(compiledPath, sourceHash))
+        return true;
+
+    Level level;
+    if (!parseLevelText(path, level))
+        return false;
+    if (!writeLevelBinary(compiledPath, level, sourceHash)) {
+        std::cout << "ERROR::LEVEL::CACHE_NOT_WRITTEN " << compiledPath
+            << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadLevel(const std::string& path, Level& level) {
+    std::string compiledPath;
+    return compileLevel(path, compiledPath) && readLevelBinary(compiledPath, level);
+}
+
+LevelFile::LevelFile()
+    : header(nullptr), cells(nullptr), chunkColumns(0), chunkRows(0) {}
+
+bool LevelFile::open(const std::string& path) {
+    close();
+    if (!file.open(path))
+        return false;
+    header = mappedHeader(file);
+    if (!header) {
+        std::cout << "ERROR::LEVEL::INVALID_BINARY " << path << std::endl;
+        file.close();
+        return false;
+    }
+    cells = file.data() + sizeof(LevelFileHeader) +
+        header->backgroundCount * 3 * sizeof(float) +
+        header->actorCount * sizeof(ActorSpawn);
+    chunkColumns = static_cast<int>(chunkCount(header->width));
+    chunkRows = static_cast<int>(chunkCount(header->height));
+    return true;
+}
+
+void LevelFile::close() {
+    file.close();
+    header = nullptr;
+    cells = nullptr;
+    chunkColumns = chunkRows = 0;
+}
+
+glm::vec3 LevelFile::playerStart() const {
+    return glm::vec3(header->playerStart[0], header->playerStart[1],
+        header->playerStart[2]);
+}
+
+void LevelFile::backgrounds(std::vector<glm::vec3>& positions) const {
+    const float* values =
+        reinterpret_cast<const float*>(file.data() + sizeof(LevelFileHeader));
+    positions.clear();
+    for (uint32_t i = 0; i < header->backgroundCount; i++)
+        positions.push_back(glm::vec3(values[3 * i], values[3 * i + 1],
+            values[3 * i + 2]));
+}
+
+void LevelFile::actors(std::vector<ActorSpawn>& spawns) const {
+    const ActorSpawn* records = reinterpret_cast<const ActorSpawn*>(file.data() +
+        sizeof(LevelFileHeader) + header->backgroundCount * 3 * sizeof(float));
+    spawns.assign(records, records + header->actorCount);
+}
+
+glm::ivec2 LevelFile::origin() const {
+    return glm::ivec2(header->originX, header->originY);
+}
+
+glm::ivec2 LevelFile::size() const {
+    return glm::ivec2(header->width, header->height);
+}
+
+const unsigned char* LevelFile::chunk(int chunkX, int chunkY) const {
+    return cells + (static_cast<size_t>(chunkY) * chunkColumns + chunkX) *
+        TILE_CHUNK_SIZE * TILE_CHUNK_SIZE;
+}
+
+void LevelFile::tiles(const glm::ivec2& first, const glm::ivec2& last,
+    std::vector<Tile>& out) const {
+    glm::ivec2 from = glm::max(first - origin(), glm::ivec2(0));
+    glm::ivec2 to = glm::min(last - origin(),
+        glm::ivec2(chunkColumns, chunkRows) * TILE_CHUNK_SIZE - 1);
+    for (int y = from.y; y <= to.y; y++) {
+        for (int x = from.x; x <= to.x; x++) {
+            unsigned char cell = chunk(x / TILE_CHUNK_SIZE, y / TILE_CHUNK_SIZE)
+                [(y % TILE_CHUNK_SIZE) * TILE_CHUNK_SIZE + x % TILE_CHUNK_SIZE];
+            if (cell == 0 || cell > BLOCK_TYPE_COUNT)
+                continue;
+            Tile tile = { header->originX + x, header->originY + y,
+                static_cast<Block_Type>(cell - 1) };
+            out.push_back(tile);
+        }
+    }
+}
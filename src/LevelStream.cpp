@@ -0,0 +1,277 @@
+#include <LevelStream.hpp>
+
+#include <StaticGeometry.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - begin).count();
+}
+
+int floorDivide(int value, int divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+int direction(float velocity) {
+    const float epsilon = 1e-4f;
+    return velocity > epsilon ? 1 : (velocity < -epsilon ? -1 : 0);
+}
+
+} // namespace
+
+LevelStream::LevelStream(size_t budget, int radius, int lookahead)
+    : budget(budget), radius(radius), lookahead(lookahead), backFaces(false),
+    bytesResident(0), bytesLoaded(0),
+    averageBytes(TILE_CHUNK_SIZE * TILE_CHUNK_SIZE * 16), stallCount(0),
+    loadTimeTotal(0.0), loadCount(0), stopping(false) {
+    for (unsigned int i = 0; i < BLOCK_TYPE_COUNT; i++)
+        occluders[i] = false;
+}
+
+LevelStream::~LevelStream() {
+    close();
+}
+
+bool LevelStream::open(const std::string& compiledPath, const bool* occluders,
+    bool backFaces) {
+    close();
+    if (!level.open(compiledPath))
+        return false;
+    for (unsigned int i = 0; i < BLOCK_TYPE_COUNT; i++)
+        this->occluders[i] = occluders[i];
+    this->backFaces = backFaces;
+    states.assign(static_cast<size_t>(level.chunksX()) * level.chunksY(), CHUNK_NONE);
+
+    stopping = false;
+    worker = std::thread(&LevelStream::work, this);
+    return true;
+}
+
+// the worker reads the level file, so it is stopped before the file closes
+// ------------------------------------------------------------------------
+void LevelStream::close() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+    requests.clear();
+    finished.clear();
+    level.close();
+    states.clear();
+    resident.clear();
+    bytesResident = 0;
+}
+
+void LevelStream::update(const glm::vec3& position, const glm::vec3& velocity,
+    TileMap& tiles, std::vector<StreamedChunk>& loaded,
+    std::vector<glm::ivec2>& evicted) {
+    if (!level.isOpen())
+        return;
+
+    // 1. take over what the worker finished since the last frame
+    std::vector<StreamedChunk> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(finished);
+    }
+    for (size_t i = 0; i < ready.size(); i++)
+        install(ready[i], tiles, loaded);
+
+    // 2. wanted chunks in priority order: the square around the player's
+    // chunk first, then the same square stepped ahead along the direction
+    // of travel
+    glm::ivec2 cell = glm::ivec2(glm::round(glm::vec2(position))) - level.origin();
+    glm::ivec2 center(floorDivide(cell.x, TILE_CHUNK_SIZE),
+        floorDivide(cell.y, TILE_CHUNK_SIZE));
+    glm::ivec2 heading(direction(velocity.x), direction(velocity.y));
+    int steps = heading == glm::ivec2(0) ? 0 : lookahead;
+
+    std::vector<glm::ivec2> wanted;
+    size_t requiredCount = 0;
+    for (int step = 0; step <= steps; step++) {
+        glm::ivec2 stepCenter = center + heading * step;
+        for (int dy = -radius; dy <= radius; dy++) {
+            for (int dx = -radius; dx <= radius; dx++) {
+                glm::ivec2 chunk = stepCenter + glm::ivec2(dx, dy);
+                if (chunk.x < 0 || chunk.y < 0 ||
+                    chunk.x >= level.chunksX() || chunk.y >= level.chunksY() ||
+                    std::find(wanted.begin(), wanted.end(), chunk) != wanted.end())
+                    continue;
+                wanted.push_back(chunk);
+            }
+        }
+        if (step == 0)
+            requiredCount = wanted.size();
+    }
+
+    // 3. the simulation is about to touch the required chunks
+    for (size_t i = 0; i < requiredCount; i++) {
+        if (stateOf(wanted[i]) == CHUNK_RESIDENT)
+            continue;
+        StreamedChunk chunk;
+        prepare(wanted[i], chunk);
+        install(chunk, tiles, loaded);
+        stallCount++;
+    }
+
+    // 4. replace the request queue with the wanted chunks that fit the
+    // budget; resident chunks count with their size, the others with the
+    // average so far
+    size_t planned = 0;
+    size_t keep = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // a request may have been loaded synchronously meanwhile
+        for (size_t i = 0; i < requests.size(); i++) {
+            Chunk_State& state = stateOf(requests[i]);
+            if (state == CHUNK_QUEUED)
+                state = CHUNK_NONE;
+        }
+        requests.clear();
+        for (; keep < wanted.size(); keep++) {
+            Chunk_State& state = stateOf(wanted[keep]);
+            size_t bytes = averageBytes;
+            for (size_t r = 0; state == CHUNK_RESIDENT && r < resident.size(); r++) {
+                if (resident[r].chunk == wanted[keep])
+                    bytes = resident[r].bytes;
+            }
+            if (keep >= requiredCount && planned + bytes > budget)
+                break;
+            planned += bytes;
+            if (state == CHUNK_NONE) {
+                requests.push_back(wanted[keep]);
+                state = CHUNK_QUEUED;
+            }
+        }
+    }
+    wake.notify_one();
+
+    // 5. over budget: evict the chunk furthest down the wanted list, or
+    // furthest away if it is not wanted at all; never a required one
+    while (bytesResident > budget) {
+        size_t worst = resident.size();
+        size_t worstScore = 0;
+        for (size_t r = 0; r < resident.size(); r++) {
+            const glm::ivec2& chunk = resident[r].chunk;
+            size_t score = std::find(wanted.begin(), wanted.end(), chunk) - wanted.begin();
+            if (score == wanted.size())
+                score += std::max(std::abs(chunk.x - center.x), std::abs(chunk.y - center.y));
+            if (score >= requiredCount && (worst == resident.size() || score > worstScore)) {
+                worst = r;
+                worstScore = score;
+            }
+        }
+        if (worst == resident.size())
+            break;
+
+        Resident victim = resident[worst];
+        resident[worst] = resident.back();
+        resident.pop_back();
+        bytesResident -= victim.bytes;
+        stateOf(victim.chunk) = CHUNK_NONE;
+        tiles.clearChunk(victim.chunk.x, victim.chunk.y);
+        evicted.push_back(victim.chunk);
+    }
+}
+
+int LevelStream::chunkId(const glm::ivec2& chunk) const {
+    return chunk.y * level.chunksX() + chunk.x;
+}
+
+double LevelStream::averageLoadTime() const {
+    return loadCount ? loadTimeTotal / loadCount : 0.0;
+}
+
+void LevelStream::work() {
+    for (;;) {
+        glm::ivec2 chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || !requests.empty(); });
+            if (stopping)
+                return;
+            chunk = requests.front();
+            requests.pop_front();
+        }
+
+        StreamedChunk result;
+        prepare(chunk, result);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(std::move(result));
+    }
+}
+
+// reads the chunk with a one cell border, so faces towards neighbouring
+// chunks are culled as if the level was meshed in one piece
+// ------------------------------------------------------------------------
+void LevelStream::prepare(const glm::ivec2& chunk, StreamedChunk& result) const {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    glm::ivec2 first = level.origin() + chunk * TILE_CHUNK_SIZE;
+    glm::ivec2 last = first + glm::ivec2(TILE_CHUNK_SIZE - 1);
+    std::vector<Tile> tiles;
+    level.tiles(first - glm::ivec2(1), last + glm::ivec2(1), tiles);
+
+    result.chunk = chunk;
+    result.layers.assign(TILE_CHUNK_SIZE * TILE_CHUNK_SIZE, 0);
+    result.bytes = result.layers.size();
+    for (size_t i = 0; i < tiles.size(); i++) {
+        glm::ivec2 local = glm::ivec2(tiles[i].x, tiles[i].y) - first;
+        if (local.x < 0 || local.y < 0 ||
+            local.x >= TILE_CHUNK_SIZE || local.y >= TILE_CHUNK_SIZE)
+            continue;
+        result.layers[local.y * TILE_CHUNK_SIZE + local.x] |= TileMap::layerOf(tiles[i].type);
+    }
+
+    StaticGeometry geometry(tiles, occluders, backFaces);
+    for (unsigned int type = 0; type < BLOCK_TYPE_COUNT; type++) {
+        if (TileMap::layerOf(static_cast<Block_Type>(type)) == 0)
+            continue;
+        StreamedChunk::Material material;
+        material.type = static_cast<Block_Type>(type);
+        material.mesh = geometry.build(material.type, first, last, material.origin);
+        if (material.mesh.indices.empty())
+            continue;
+        size_t indexSize = material.mesh.vertices.size() <= 65536 ? 2 : 4;
+        result.bytes += material.mesh.vertices.size() * sizeof(PackedVertex) +
+            material.mesh.indices.size() * indexSize;
+        result.materials.push_back(std::move(material));
+    }
+    result.loadTime = millisecondsSince(start);
+}
+
+// a chunk can finish on the worker after it was loaded synchronously; the
+// second copy is dropped
+// ------------------------------------------------------------------------
+void LevelStream::install(StreamedChunk& chunk, TileMap& tiles,
+    std::vector<StreamedChunk>& loaded) {
+    Chunk_State& state = stateOf(chunk.chunk);
+    if (state == CHUNK_RESIDENT)
+        return;
+    state = CHUNK_RESIDENT;
+
+    tiles.setChunk(chunk.chunk.x, chunk.chunk.y, &chunk.layers[0]);
+    Resident entry = { chunk.chunk, chunk.bytes };
+    resident.push_back(entry);
+    bytesResident += chunk.bytes;
+
+    loadTimeTotal += chunk.loadTime;
+    loadCount++;
+    bytesLoaded += chunk.bytes;
+    averageBytes = bytesLoaded / loadCount;
+    loaded.push_back(std::move(chunk));
+}
+
+LevelStream::Chunk_State& LevelStream::stateOf(const glm::ivec2& chunk) {
+    return states[static_cast<size_t>(chunk.y) * level.chunksX() + chunk.x];
+}
@@ -0,0 +1,214 @@
+#include <LightGrid.hpp>
+
+#include <Profiler.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// cells never get smaller than this, so a handful of lights close together
+// does not spread over the whole grid
+const float MIN_CELL_SIZE = 2.0f;
+
+} // namespace
+
+LightGrid::LightGrid(int columns, int rows)
+    : columns(columns), rows(rows), changed(false), maxPerCell(0), lit(false),
+    gridOrigin(0.0f), cellSize(1.0f), gridSize(0), gridDepth(0.0f) {
+    createBufferTexture(lightTexels, GL_RGBA32F);
+    createBufferTexture(cellTable, GL_RG32UI);
+    createBufferTexture(indexList, GL_R32UI);
+}
+
+LightGrid::~LightGrid() {
+    for (const BufferTexture* target : { &lightTexels, &cellTable, &indexList }) {
+        glDeleteTextures(1, &target->texture);
+        glDeleteBuffers(1, &target->buffer);
+    }
+}
+
+void LightGrid::clear() {
+    lights.clear();
+    chunks.clear();
+    changed = true;
+}
+
+void LightGrid::addLight(const glm::vec3& position, float radius, const glm::vec3& color,
+    int chunk) {
+    PointLight light = { position, radius, color, chunk };
+    lights.push_back(light);
+    group(lights.size() - 1);
+    changed = true;
+}
+
+void LightGrid::removeChunk(int chunk) {
+    size_t kept = 0;
+    for (size_t i = 0; i < lights.size(); i++) {
+        if (lights[i].chunk != chunk)
+            lights[kept++] = lights[i];
+    }
+    if (kept == lights.size())
+        return;
+    lights.resize(kept);
+    chunks.clear();
+    for (size_t i = 0; i < lights.size(); i++)
+        group(i);
+    changed = true;
+}
+
+// culls every frame, but bins and uploads only when the visible lights are
+// not the ones of the last bin
+// ---------------------------------------------------------------------------------------------
+void LightGrid::update(const Frustum& frustum, float brightness, LightUniforms& uniforms) {
+    lit = brightness > 0.0f;
+    if (lit) {
+        cull(frustum);
+        if (changed || culled != visible) {
+            visible.swap(culled);
+            bin();
+            changed = false;
+        }
+    }
+
+    uniforms.gridOrigin = gridOrigin;
+    uniforms.cellSize = cellSize;
+    uniforms.gridSize = lit ? gridSize : glm::ivec2(0);
+    uniforms.gridDepth = gridDepth;
+    uniforms.brightness = brightness;
+}
+
+// lights are added a chunk at a time, so a chunk's lights are one run and
+// extending the last run is enough
+// ---------------------------------------------------------------------------------------------
+void LightGrid::group(size_t light) {
+    const PointLight& added = lights[light];
+    glm::vec3 extent(added.radius);
+    if (chunks.empty() || chunks.back().chunk != added.chunk) {
+        ChunkLights run = { added.chunk, light, 0, glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+        chunks.push_back(run);
+    }
+    ChunkLights& run = chunks.back();
+    run.count++;
+    run.boundsMin = glm::min(run.boundsMin, added.position - extent);
+    run.boundsMax = glm::max(run.boundsMax, added.position + extent);
+}
+
+// a chunk outside the frustum drops all its lights with one test, so the
+// cost follows the lights near the view rather than all resident ones
+// ---------------------------------------------------------------------------------------------
+void LightGrid::cull(const Frustum& frustum) {
+    culled.clear();
+    for (size_t c = 0; c < chunks.size(); c++) {
+        const ChunkLights& run = chunks[c];
+        if (!frustum.intersects(run.boundsMin, run.boundsMax))
+            continue;
+        for (size_t i = run.first; i < run.first + run.count; i++) {
+            glm::vec3 extent(lights[i].radius);
+            if (frustum.intersects(lights[i].position - extent, lights[i].position + extent))
+                culled.push_back(static_cast<unsigned int>(i));
+        }
+    }
+}
+
+// counting sort of the visible lights into the cells their xy bounds
+// overlap: count per cell, prefix sum into first indices, then scatter
+// ---------------------------------------------------------------------------------------------
+void LightGrid::bin() {
+    glm::vec3 boundsMin(FLT_MAX);
+    glm::vec3 boundsMax(-FLT_MAX);
+    for (size_t i = 0; i < visible.size(); i++) {
+        const PointLight& light = lights[visible[i]];
+        boundsMin = glm::min(boundsMin, light.position - light.radius);
+        boundsMax = glm::max(boundsMax, light.position + light.radius);
+    }
+
+    gridSize = glm::ivec2(0);
+    cellSize = glm::vec2(1.0f);
+    if (!visible.empty()) {
+        glm::vec2 size = glm::vec2(boundsMax - boundsMin);
+        cellSize = glm::max(size / glm::vec2(columns, rows), glm::vec2(MIN_CELL_SIZE));
+        gridSize = glm::min(glm::ivec2(glm::ceil(size / cellSize)), glm::ivec2(columns, rows));
+        gridSize = glm::max(gridSize, glm::ivec2(1));
+    }
+    size_t cellCount = static_cast<size_t>(gridSize.x) * gridSize.y;
+
+    cellRanges.resize(visible.size());
+    cells.assign(std::max<size_t>(cellCount, 1) * 2, 0);
+    for (size_t i = 0; i < visible.size(); i++) {
+        const PointLight& light = lights[visible[i]];
+        glm::vec2 low = glm::vec2(light.position - light.radius - boundsMin) / cellSize;
+        glm::vec2 high = glm::vec2(light.position + light.radius - boundsMin) / cellSize;
+        glm::ivec2 first = glm::clamp(glm::ivec2(glm::floor(low)), glm::ivec2(0), gridSize - 1);
+        glm::ivec2 last = glm::clamp(glm::ivec2(glm::floor(high)), glm::ivec2(0), gridSize - 1);
+        cellRanges[i] = glm::ivec4(first, last);
+        for (int y = first.y; y <= last.y; y++)
+            for (int x = first.x; x <= last.x; x++)
+                cells[(y * gridSize.x + x) * 2 + 1]++;
+    }
+
+    unsigned int total = 0;
+    maxPerCell = 0;
+    for (size_t cell = 0; cell < cellCount; cell++) {
+        cells[cell * 2] = total;
+        total += cells[cell * 2 + 1];
+        maxPerCell = std::max(maxPerCell, cells[cell * 2 + 1]);
+        // refilled below
+        cells[cell * 2 + 1] = 0;
+    }
+
+    indices.resize(std::max(total, 1u));
+    texels.resize(std::max<size_t>(visible.size(), 1) * 2);
+    for (size_t i = 0; i < visible.size(); i++) {
+        const PointLight& light = lights[visible[i]];
+        texels[i * 2] = glm::vec4(light.position, light.radius);
+        texels[i * 2 + 1] = glm::vec4(light.color, 0.0f);
+        const glm::ivec4& range = cellRanges[i];
+        for (int y = range.y; y <= range.w; y++) {
+            for (int x = range.x; x <= range.z; x++) {
+                unsigned int* cell = &cells[(y * gridSize.x + x) * 2];
+                indices[cell[0] + cell[1]++] = static_cast<unsigned int>(i);
+            }
+        }
+    }
+
+    upload(lightTexels, &texels[0], texels.size() * sizeof(glm::vec4));
+    upload(cellTable, &cells[0], cells.size() * sizeof(unsigned int));
+    upload(indexList, &indices[0], indices.size() * sizeof(unsigned int));
+
+    bool empty = visible.empty();
+    gridOrigin = empty ? glm::vec2(0.0f) : glm::vec2(boundsMin);
+    gridDepth = empty ? glm::vec2(0.0f) : glm::vec2(boundsMin.z, boundsMax.z);
+}
+
+void LightGrid::bind() const {
+    glActiveTexture(GL_TEXTURE0 + LIGHT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, lightTexels.texture);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_CELL_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, cellTable.texture);
+    glActiveTexture(GL_TEXTURE0 + LIGHT_INDEX_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, indexList.texture);
+    glActiveTexture(GL_TEXTURE0);
+    Profiler::count(COUNTER_TEXTURE_BINDS, 3);
+}
+
+void LightGrid::createBufferTexture(BufferTexture& target, GLenum format) {
+    glGenBuffers(1, &target.buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_BUFFER, target.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, target.buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// respecifies the whole store, like UniformBuffer::update, so the driver can
+// orphan the copy a frame in flight still reads
+// ------------------------------------------------------------------------
+void LightGrid::upload(const BufferTexture& target, const void* data, size_t size) {
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(size), data, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
@@ -0,0 +1,234 @@
+#include <MappedFile.hpp>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <direct.h>
+#include <process.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+bool isSeparator(char c) {
+    return c == '/' || c == '\\';
+}
+
+// creates every missing directory along path
+void makeDirectories(const std::string& path) {
+    for (size_t end = 1; end <= path.size(); end++) {
+        if (end < path.size() && !isSeparator(path[end]))
+            continue;
+        std::string prefix = path.substr(0, end);
+#ifdef _WIN32
+        _mkdir(prefix.c_str());
+#else
+        mkdir(prefix.c_str(), 0755);
+#endif
+    }
+}
+
+// path joined to the working directory unless it is absolute already
+std::string absolutePath(const std::string& path) {
+    bool absolute = !path.empty() && isSeparator(path[0]);
+#ifdef _WIN32
+    absolute |= path.size() > 1 && path[1] == ':';
+    char* current = _getcwd(nullptr, 0);
+#else
+    char* current = getcwd(nullptr, 0);
+#endif
+    if (absolute || !current) {
+        std::free(current);
+        return path;
+    }
+    std::string result = std::string(current) + "/" + path;
+    std::free(current);
+    return result;
+}
+
+std::string createCacheDirectory() {
+#ifdef ICYHOT_CACHE_DIR
+    std::string directory = ICYHOT_CACHE_DIR;
+#else
+    std::string directory;
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    if (xdg && *xdg)
+        directory = std::string(xdg) + "/icyhot";
+    else if (home && *home)
+        directory = std::string(home) + "/.cache/icyhot";
+    else
+        directory = absolutePath("icyhot-cache");
+#endif
+    makeDirectories(directory);
+    return directory;
+}
+
+} // namespace
+
+#ifdef _WIN32
+MappedFile::MappedFile()
+    : fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr), bytes(nullptr),
+    length(0) {}
+#else
+MappedFile::MappedFile() : fd(-1), bytes(nullptr), length(0) {}
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0,
+        nullptr);
+    if (!mappingHandle) {
+        close();
+        return false;
+    }
+    bytes = static_cast<const unsigned char*>(
+        MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    length = static_cast<size_t>(fileSize.QuadPart);
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close();
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+        MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close();
+        return false;
+    }
+    bytes = static_cast<const unsigned char*>(mapping);
+    length = static_cast<size_t>(info.st_size);
+#endif
+    if (!bytes) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (bytes)
+        UnmapViewOfFile(bytes);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (bytes)
+        munmap(const_cast<unsigned char*>(bytes), length);
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+#endif
+    bytes = nullptr;
+    length = 0;
+}
+
+bool fileStamp(const std::string& path, unsigned long long& size,
+    long long& modified) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+    size = static_cast<unsigned long long>(info.st_size);
+    modified = static_cast<long long>(info.st_mtime);
+    return true;
+}
+
+bool replaceFile(const std::string& path, const FilePart* parts, size_t count) {
+    // unique per process and per call, for concurrent texture workers and
+    // other instances sharing the cache directory
+    static std::atomic<unsigned int> serial(0);
+#ifdef _WIN32
+    int process = _getpid();
+#else
+    int process = static_cast<int>(getpid());
+#endif
+    char tag[32];
+    std::snprintf(tag, sizeof(tag), ".%d.%u.tmp", process, serial++);
+    std::string temporary = path + tag;
+
+    std::ofstream file(temporary.c_str(), std::ios::binary);
+    for (size_t i = 0; i < count && file; i++)
+        file.write(static_cast<const char*>(parts[i].data),
+            static_cast<std::streamsize>(parts[i].size));
+    file.close();
+    bool written = static_cast<bool>(file);
+#ifdef _WIN32
+    written = written && MoveFileExA(temporary.c_str(), path.c_str(),
+        MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    written = written && std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+    if (!written)
+        std::remove(temporary.c_str());
+    return written;
+}
+
+unsigned long long hashBytes(const void* data, size_t size, unsigned long long hash) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool fileHash(const std::string& path, unsigned long long& hash) {
+    MappedFile file;
+    hash = FNV_OFFSET_BASIS;
+    // an empty file cannot be mapped but hashes fine
+    unsigned long long size = 0;
+    long long modified = 0;
+    if (!file.open(path))
+        return fileStamp(path, size, modified) && size == 0;
+    hash = hashBytes(file.data(), file.size());
+    return true;
+}
+
+std::string cacheDirectory() {
+    // texture workers ask concurrently; a local static is set up only once
+    static const std::string directory = createCacheDirectory();
+    return directory;
+}
+
+std::string cachePath(const std::string& source, const std::string& suffix) {
+    std::string full = absolutePath(source);
+    unsigned long long hash = hashBytes(full.data(), full.size());
+    size_t slash = source.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? source : source.substr(slash + 1);
+    char tag[10];
+    std::snprintf(tag, sizeof(tag), ".%08x", static_cast<unsigned int>(hash));
+    return cacheDirectory() + "/" + name + tag + suffix;
+}
@@ -0,0 +1,135 @@
+#include <Mesh.hpp>
+
+#include <Profiler.hpp>
+
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+// position, normal, uv per corner; each face is two triangles 0-1-2, 2-3-0
+const float cubeVertices[24][8] = {
+    // REAR
+    { -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f },
+    {  0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f },
+    {  0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f },
+    { -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f },
+    // FRONT
+    { -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f },
+    {  0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  0.0f },
+    {  0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f },
+    { -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  1.0f },
+    // LEFT
+    { -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f },
+    { -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  1.0f },
+    { -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f },
+    { -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f },
+    // RIGHT
+    {  0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f },
+    {  0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  1.0f },
+    {  0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f },
+    {  0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f },
+    // BOTTOM
+    { -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f },
+    {  0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  1.0f },
+    {  0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f },
+    { -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f },
+    // TOP
+    { -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f },
+    {  0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f },
+    {  0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f },
+    { -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f },
+};
+
+PackedVertex pack(const MeshVertex& vertex) {
+    PackedVertex packed;
+    for (int i = 0; i < 3; i++)
+        packed.position[i] = glm::packHalf1x16(vertex.position[i]);
+    packed.position[3] = 0;
+    packed.normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f));
+    packed.uv[0] = glm::packHalf1x16(vertex.uv.x);
+    packed.uv[1] = glm::packHalf1x16(vertex.uv.y);
+    return packed;
+}
+
+} // namespace
+
+MeshData cubeMesh() {
+    MeshData cube;
+    for (unsigned int i = 0; i < 24; i++) {
+        const float* v = cubeVertices[i];
+        MeshVertex vertex = { glm::vec3(v[0], v[1], v[2]),
+            glm::vec3(v[3], v[4], v[5]), glm::vec2(v[6], v[7]) };
+        cube.vertices.push_back(vertex);
+    }
+    const unsigned int quad[6] = { 0, 1, 2, 2, 3, 0 };
+    for (unsigned int face = 0; face < 6; face++)
+        for (unsigned int i = 0; i < 6; i++)
+            cube.indices.push_back(face * 4 + quad[i]);
+    return cube;
+}
+
+Mesh::Mesh(const MeshData& data)
+    : vertices(static_cast<unsigned int>(data.vertices.size())),
+    indices(static_cast<unsigned int>(data.indices.size())) {
+    std::vector<PackedVertex> packed;
+    packed.reserve(data.vertices.size());
+    for (size_t i = 0; i < data.vertices.size(); i++)
+        packed.push_back(pack(data.vertices[i]));
+
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex),
+        packed.empty() ? nullptr : &packed[0], GL_STATIC_DRAW);
+
+    // the element buffer binding is vertex array state, so keep whatever
+    // array is bound from capturing it
+    glBindVertexArray(0);
+    glGenBuffers(1, &EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    if (vertices <= 65536) {
+        indexType = GL_UNSIGNED_SHORT;
+        std::vector<unsigned short> shortIndices(data.indices.begin(),
+            data.indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+            shortIndices.size() * sizeof(unsigned short),
+            shortIndices.empty() ? nullptr : &shortIndices[0], GL_STATIC_DRAW);
+    }
+    else {
+        indexType = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+            data.indices.size() * sizeof(unsigned int),
+            data.indices.empty() ? nullptr : &data.indices[0], GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+Mesh::~Mesh() {
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
+
+void Mesh::bindAttributes() const {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex),
+        (void*)0);
+    glEnableVertexAttribArray(0);
+    // packed formats need all four components; the shader reads xyz
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+        sizeof(PackedVertex), (void*)(4 * sizeof(uint16_t)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex),
+        (void*)(4 * sizeof(uint16_t) + sizeof(uint32_t)));
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+}
+
+void Mesh::draw() const {
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices), indexType, (void*)0);
+    Profiler::count(COUNTER_DRAW_CALLS);
+}
+
+void Mesh::drawInstanced(GLsizei instances) const {
+    glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(indices), indexType,
+        (void*)0, instances);
+    Profiler::count(COUNTER_DRAW_CALLS);
+}
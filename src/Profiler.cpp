@@ -0,0 +1,245 @@
+#include <Profiler.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+namespace {
+
+const size_t EVENTS_PER_FRAME = 64;
+
+const char* counterName(int counter) {
+    switch (counter) {
+    case COUNTER_DRAW_CALLS: return "draw calls";
+    case COUNTER_STATE_CHANGES: return "state changes";
+    case COUNTER_UNIFORM_CALLS: return "uniform calls";
+    case COUNTER_TEXTURE_BINDS: return "texture binds";
+    default: return "";
+    }
+}
+
+// nearest rank percentile of sorted values
+float percentile(const std::vector<float>& sorted, float p) {
+    size_t rank = static_cast<size_t>(p * (sorted.size() - 1) + 0.5f);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+void printRow(std::ostream& out, const std::string& name,
+    std::vector<float> values, float scale) {
+    if (values.empty())
+        return;
+    std::sort(values.begin(), values.end());
+    out << "  " << std::left << std::setw(24) << name << std::right
+        << std::fixed << std::setprecision(3)
+        << std::setw(10) << percentile(values, 0.50f) * scale
+        << std::setw(10) << percentile(values, 0.95f) * scale
+        << std::setw(10) << percentile(values, 0.99f) * scale
+        << std::setw(10) << values.back() * scale << std::endl;
+}
+
+} // namespace
+
+unsigned int Profiler::counters[FRAME_COUNTER_COUNT];
+
+Profiler::Profiler(size_t frames)
+    : active(false), epoch(std::chrono::steady_clock::now()), frameIndex(0),
+    frameStart(0.0), events(frames * EVENTS_PER_FRAME), eventHead(0),
+    eventCount(0), frames(frames), recordedFrames(0), openPass(nullptr) {}
+
+Profiler::~Profiler() {
+    for (size_t i = 0; i < passes.size(); i++)
+        glDeleteQueries(2, passes[i].queries);
+}
+
+void Profiler::setEnabled(bool enabled) {
+    active = enabled;
+}
+
+void Profiler::beginFrame() {
+    for (int i = 0; i < FRAME_COUNTER_COUNT; i++)
+        counters[i] = 0;
+    if (!active)
+        return;
+
+    frameIndex++;
+    frameStart = now();
+    // last frame's passes, if the GPU is done with them
+    int previous = static_cast<int>((frameIndex - 1) & 1);
+    for (size_t i = 0; i < passes.size(); i++)
+        collect(passes[i], previous, false);
+}
+
+void Profiler::endFrame() {
+    if (!active)
+        return;
+    Frame& frame = frames[recordedFrames % frames.size()];
+    frame.start = frameStart;
+    frame.duration = now() - frameStart;
+    for (int i = 0; i < FRAME_COUNTER_COUNT; i++)
+        frame.counters[i] = counters[i];
+    recordedFrames++;
+    record("frame", frame.start, frame.duration, CPU_TRACK);
+}
+
+void Profiler::beginScope(const char* name) {
+    if (active)
+        open.push_back(std::make_pair(name, now()));
+}
+
+void Profiler::endScope() {
+    if (!active || open.empty())
+        return;
+    std::pair<const char*, double> scope = open.back();
+    open.pop_back();
+    record(scope.first, scope.second, now() - scope.second, CPU_TRACK);
+}
+
+void Profiler::addThreadScope(const char* name, std::chrono::steady_clock::time_point start,
+    double seconds) {
+    if (active)
+        record(name, std::chrono::duration<double, std::micro>(start - epoch).count(),
+            seconds * 1e6, SIMULATION_TRACK);
+}
+
+void Profiler::beginGpu(const char* name) {
+    if (!active || openPass)
+        return;
+    GpuPass* pass = nullptr;
+    for (size_t i = 0; i < passes.size() && !pass; i++) {
+        if (passes[i].name == name)
+            pass = &passes[i];
+    }
+    if (!pass) {
+        GpuPass created = { name, { 0, 0 }, { 0.0, 0.0 }, { false, false } };
+        glGenQueries(2, created.queries);
+        passes.push_back(created);
+        pass = &passes.back();
+    }
+
+    // the query from two frames ago must be read before it is reused
+    int slot = static_cast<int>(frameIndex & 1);
+    collect(*pass, slot, true);
+    pass->issued[slot] = now();
+    glBeginQuery(GL_TIME_ELAPSED, pass->queries[slot]);
+    openPass = pass;
+}
+
+void Profiler::endGpu() {
+    if (!openPass)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    openPass->pending[frameIndex & 1] = true;
+    openPass = nullptr;
+}
+
+void Profiler::report(std::ostream& out) const {
+    size_t kept = std::min(recordedFrames, frames.size());
+    out << "PROFILE::" << kept << " frames, milliseconds" << std::endl
+        << "  " << std::left << std::setw(24) << "scope" << std::right
+        << std::setw(10) << "p50" << std::setw(10) << "p95"
+        << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+    std::map<std::string, const Samples*> sorted;
+    for (std::unordered_map<const char*, Samples>::const_iterator it = samples.begin();
+        it != samples.end(); it++)
+        sorted[std::string(trackName(it->second.track)) + " " + it->first] = &it->second;
+    for (std::map<std::string, const Samples*>::const_iterator it = sorted.begin();
+        it != sorted.end(); it++)
+        printRow(out, it->first, it->second->values, 0.001f);
+    for (int counter = 0; counter < FRAME_COUNTER_COUNT; counter++) {
+        std::vector<float> values;
+        for (size_t i = 0; i < kept; i++)
+            values.push_back(static_cast<float>(frames[i].counters[counter]));
+        printRow(out, counterName(counter), values, 1.0f);
+    }
+}
+
+bool Profiler::dumpChromeTrace(const std::string& path) const {
+    std::ofstream file(path.c_str());
+    if (!file) {
+        std::cout << "ERROR::PROFILER::FILE_NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+        "\"args\":{\"name\":\"CPU\"}},\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,"
+        "\"args\":{\"name\":\"GPU\"}},\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":3,"
+        "\"args\":{\"name\":\"Simulation\"}}";
+
+    // oldest first
+    size_t first = (eventHead + events.size() - eventCount) % events.size();
+    for (size_t i = 0; i < eventCount; i++) {
+        const Event& event = events[(first + i) % events.size()];
+        file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\""
+            << trackName(event.track)
+            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << static_cast<int>(event.track)
+            << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+    }
+
+    size_t kept = std::min(recordedFrames, frames.size());
+    for (size_t i = 0; i < kept; i++) {
+        const Frame& frame = frames[(recordedFrames - kept + i) % frames.size()];
+        file << ",\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+            << frame.start << ",\"args\":{";
+        for (int counter = 0; counter < FRAME_COUNTER_COUNT; counter++)
+            file << (counter ? "," : "") << "\"" << counterName(counter) << "\":"
+                << frame.counters[counter];
+        file << "}}";
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(file);
+}
+
+const char* Profiler::trackName(unsigned char track) {
+    switch (track) {
+    case GPU_TRACK: return "gpu";
+    case SIMULATION_TRACK: return "sim";
+    default: return "cpu";
+    }
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::record(const char* name, double start, double duration,
+    unsigned char track) {
+    Event& event = events[eventHead];
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    event.track = track;
+    eventHead = (eventHead + 1) % events.size();
+    eventCount = std::min(eventCount + 1, events.size());
+
+    Samples& series = samples[name];
+    series.track = track;
+    if (series.values.size() < frames.size()) {
+        series.values.push_back(static_cast<float>(duration));
+        series.next = 0;
+    }
+    else {
+        series.values[series.next] = static_cast<float>(duration);
+        series.next = (series.next + 1) % series.values.size();
+    }
+}
+
+void Profiler::collect(GpuPass& pass, int slot, bool wait) {
+    if (!pass.pending[slot])
+        return;
+    if (!wait) {
+        GLint available = 0;
+        glGetQueryObjectiv(pass.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+    }
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &elapsed);
+    pass.pending[slot] = false;
+    record(pass.name, pass.issued[slot], elapsed / 1000.0, GPU_TRACK);
+}
@@ -0,0 +1,310 @@
+#include <Scene.hpp>
+
+#include <Level.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// level streaming: bytes of chunk collision and meshes kept resident. Lava
+// and ice are toggled at runtime, so only stone and finish tiles hide their
+// neighbours' faces
+const size_t LEVEL_STREAM_BUDGET = 8 * 1024 * 1024;
+const bool LEVEL_OCCLUDERS[BLOCK_TYPE_COUNT] = { true, true, false, false, false, false };
+
+// every lava block glows while lava is active; the light sits in front of the
+// block so it reaches the front faces around it
+const float LAVA_LIGHT_RADIUS = 3.0f;
+const float LAVA_LIGHT_DEPTH = 1.0f;
+const glm::vec3 LAVA_LIGHT_COLOR(1.2f, 0.5f, 0.12f);
+
+} // namespace
+
+// the material comes in two variants, picked per frame: UNIFORM_SCALE
+// transforms normals with the model matrix, the general one reads the
+// per-instance normal matrix. Every image becomes one layer of a single
+// texture array, resampled to a common size, so drawing the level binds
+// nothing per batch
+// ---------------------------------------------------------------------------------------------
+Scene::Scene(const std::string& resources, Profiler& profiler)
+    : profiler(profiler), shaderLocation(resources + "shaders/"),
+    lightingShader(resources + "shaders/material.vert",
+        resources + "shaders/material.frag", "#define UNIFORM_SCALE\n"),
+    lightingShaderGeneral(resources + "shaders/material.vert",
+        resources + "shaders/material.frag"),
+    lampShader(resources + "shaders/lamp.vert", resources + "shaders/lamp.frag"),
+    cube(cubeMesh()),
+    textures(1024, 1024),
+    frameBuffer(FRAME_BLOCK_BINDING, sizeof(FrameUniforms)),
+    lightBuffer(LIGHT_BLOCK_BINDING, sizeof(LightUniforms)),
+    lightPos(0.0f, 15.0f, 15.0f),
+    world(LEVEL_STREAM_BUDGET, LEVEL_OCCLUDERS),
+    alpha(0.0f),
+    blockRenderer(cube, textures.ID) {
+    // the light object is also a cube, drawn without instance attributes
+    glGenVertexArrays(1, &lightVAO);
+    glBindVertexArray(lightVAO);
+    cube.bindAttributes();
+    glBindVertexArray(0);
+
+    std::string textureLocation = resources + "textures/";
+    for (unsigned int i = 0; i < BLOCK_TYPE_COUNT; i++)
+        blockLayers[i] = 0;
+    blockLayers[STONE] = textures.addLayer(textureLocation + "rock.png");    // Cobblestone
+    blockLayers[FINISH] = textures.addLayer(textureLocation + "chess4.png"); // Finish
+    blockLayers[LAVA] = textures.addLayer(textureLocation + "lava.png");     // Lava
+    blockLayers[ICE] = textures.addLayer(textureLocation + "ice.png");       // Ice
+
+    // animation frames take consecutive layers
+    rickFrames = textures.addLayer(textureLocation + "rick1.png");
+    textures.addLayer(textureLocation + "rick2.png");
+    textures.addLayer(textureLocation + "rick3.png");
+    textures.addLayer(textureLocation + "rick4.png");
+
+    // actors reuse the block textures: walking ice, stone platforms and
+    // lava projectiles
+    actorLayers[ENEMY] = blockLayers[ICE];
+    actorLayers[PLATFORM] = blockLayers[STONE];
+    actorLayers[PROJECTILE] = blockLayers[LAVA];
+    for (unsigned int i = 0; i < ENTITY_KIND_COUNT; i++)
+        actorFrames[i] = 1;
+
+    unsigned int bg1 = textures.addLayer(textureLocation + "cave_bg.png");
+    unsigned int bg2 = textures.addLayer(textureLocation + "cave_bg2.png");
+    backgroundLayers[0] = bg2;
+    backgroundLayers[1] = bg1;
+
+    textures.upload();
+
+    // camera and light state is shared by every program through uniform
+    // blocks at fixed binding points and uploaded once per frame
+    lightUniforms.ambient = glm::vec4(0.2f, 0.2f, 0.2f, 0.0f);
+    lightUniforms.specular = glm::vec4(0.5f, 0.5f, 0.5f, 0.0f);
+
+    configureMaterialShader(lightingShader, uShininess);
+    configureMaterialShader(lightingShaderGeneral, uShininessGeneral);
+    configureLampShader(lampShader);
+}
+
+Scene::~Scene() {
+    glDeleteVertexArrays(1, &lightVAO);
+}
+
+// nothing of the old level is still queued once the world has switched, so
+// the renderer starts over from the new level's first snapshot
+// ---------------------------------------------------------------------------------------------
+bool Scene::loadLevel(const std::string& path) {
+    std::string compiled;
+    LevelFile probe;
+    if (!compileLevel(path, compiled) || !probe.open(compiled))
+        return false;
+    probe.close();
+    if (!world.open(compiled))
+        return false;
+
+    world.acquire();
+    alpha = 0.0f;
+    blockRenderer.clear();
+    lightGrid.clear();
+    addBackgrounds();
+    return true;
+}
+
+void Scene::watch(FileWatcher& watcher) const {
+    for (const char* name : { "material.vert", "material.frag", "lamp.vert", "lamp.frag" })
+        watcher.watch(shaderLocation + name);
+    for (unsigned int layer = 0; layer < textures.layerCount(); layer++)
+        watcher.watch(textures.layerPath(layer));
+}
+
+void Scene::reload(const std::string& path) {
+    if (lightingShader.dependsOn(path) && lightingShader.reload())
+        configureMaterialShader(lightingShader, uShininess);
+    if (lightingShaderGeneral.dependsOn(path) && lightingShaderGeneral.reload())
+        configureMaterialShader(lightingShaderGeneral, uShininessGeneral);
+    if (lampShader.dependsOn(path) && lampShader.reload())
+        configureLampShader(lampShader);
+    textures.reloadLayer(path);
+}
+
+void Scene::update(float deltaTime, TickInput& input, std::vector<TickInput>* recorded) {
+    world.setRecording(recorded);
+    world.advance(deltaTime, input, profiler);
+    receiveChunks();
+    world.acquire();
+    alpha = world.lag() / FIXED_TIMESTEP;
+}
+
+void Scene::startSimulation(std::vector<TickInput>* recorded) {
+    world.setRecording(recorded);
+    world.start();
+}
+
+void Scene::stopSimulation() {
+    world.stop();
+}
+
+// the snapshot is drawn one tick behind the simulation clock, between its
+// previous and its last tick, so the player moves smoothly whatever the
+// display rate
+// ---------------------------------------------------------------------------------------------
+void Scene::sync() {
+    profiler.beginScope("sync");
+    receiveChunks();
+    ThreadScope scope;
+    while (world.takeScope(scope))
+        profiler.addThreadScope(scope.name, scope.start, scope.seconds);
+    world.acquire();
+    const WorldSnapshot& current = world.snapshot();
+    float behind = static_cast<float>(world.now() - current.time) / FIXED_TIMESTEP;
+    alpha = std::max(0.0f, std::min(behind, 1.0f));
+    profiler.endScope();
+}
+
+void Scene::render(const glm::mat4& projection, const glm::mat4& view,
+    const glm::vec3& viewPos, float time) {
+    const WorldSnapshot& current = world.snapshot();
+    char currentState = current.state;
+
+    profiler.beginScope("uniforms");
+    glClearColor(0.75f, 0.75f, 0.75f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // view/projection transformations
+    frameUniforms.projection = projection;
+    frameUniforms.view = view;
+    frameUniforms.viewPos = viewPos;
+    frustum.extract(projection * view);
+    frameUniforms.time = time;
+    frameBuffer.update(frameUniforms);
+
+    // light properties: the lamp is steady, the lava lights pulse and are
+    // off while the ice is out
+    lightUniforms.position = glm::vec4(lightPos, 1.0f);
+    lightUniforms.diffuse = glm::vec4(0.75f, 0.75f, 0.75f, 0.0f);
+    float lavaGlow = currentState == 'L' ? (sin(time * 2.5f) + 2) / 4 : 0.0f;
+    lightGrid.update(frustum, lavaGlow, lightUniforms);
+    lightBuffer.update(lightUniforms);
+
+    // Player
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), current.playerStart);
+
+    // one animation frame every 20 ticks
+    unsigned int playerLayer = rickFrames + current.animationTick / 20;
+
+    // draw between the last two simulated states
+    model = glm::translate(model, glm::mix(current.previousMove, current.move, alpha));
+    model = glm::scale(model, glm::vec3(Simulation::playerScale));
+
+    blockRenderer.setPlayer(model, playerLayer);
+    blockRenderer.setActors(current.actors, alpha, actorLayers, actorFrames);
+
+    // be sure to activate shader when setting uniforms/drawing objects;
+    // the cheaper variant whenever no instance needs a normal matrix
+    bool uniformScale = blockRenderer.uniformScale();
+    (uniformScale ? lightingShader : lightingShaderGeneral).use();
+
+    // material properties
+    (uniformScale ? uShininess : uShininessGeneral).set(64.0f);
+    profiler.endScope();
+
+    // render the frame of cubes, one instanced draw per batch
+    profiler.beginScope("draw");
+    profiler.beginGpu("blocks");
+    blockRenderer.setVisible(LAVA, currentState == 'L');
+    blockRenderer.setVisible(ICE, currentState == 'I');
+    lightGrid.bind();
+    blockRenderer.draw(frustum);
+    profiler.endGpu();
+
+    // draw the lamp object
+    profiler.beginGpu("lamp");
+    lampShader.use();
+    uLampModel.set(glm::translate(glm::mat4(1.0f), lightPos));
+
+    glBindVertexArray(lightVAO);
+    Profiler::count(COUNTER_STATE_CHANGES);
+    cube.draw();
+    profiler.endGpu();
+    profiler.endScope();
+}
+
+void Scene::setTrace(TraceRing* ring) {
+    world.setTrace(ring);
+}
+
+// sampler units, uniform block bindings and uniform handles; run again after a
+// program is hot reloaded, since its ID and locations change. The render loop
+// sets uniforms through the handles and does no name lookups
+// ---------------------------------------------------------------------------------------------
+void Scene::configureMaterialShader(Shader& shader, Uniform<float>& uShininess) {
+    shader.use();
+    shader.setInt("material.diffuse", 0);
+    shader.setInt("lights", LIGHT_TEXTURE_UNIT);
+    shader.setInt("lightCells", LIGHT_CELL_TEXTURE_UNIT);
+    shader.setInt("lightIndices", LIGHT_INDEX_TEXTURE_UNIT);
+    shader.bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
+    shader.bindUniformBlock("LightBlock", LIGHT_BLOCK_BINDING);
+
+    uShininess = shader.uniform<float>("material.shininess");
+}
+
+// ---------------------------------------------------------------------------------------------
+void Scene::configureLampShader(Shader& shader) {
+    shader.bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
+
+    uLampModel = shader.uniform<glm::mat4>("model");
+}
+
+// backgrounds alternate between the two cave layers and stay instanced cubes
+// ---------------------------------------------------------------------------------------------
+void Scene::addBackgrounds() {
+    std::vector<glm::vec3> backgrounds;
+    world.file().backgrounds(backgrounds);
+    for (size_t i = 0; i < backgrounds.size(); i++)
+        blockRenderer.addBlock(BACKGROUND, backgroundLayers[i % 2], backgrounds[i], 20.0f);
+}
+
+// in the order the world streamed them, so a chunk evicted and loaded again
+// ends up drawn once
+// ---------------------------------------------------------------------------------------------
+void Scene::receiveChunks() {
+    while (world.takeChunk(chunkChange)) {
+        if (!chunkChange.evicted) {
+            addChunk(chunkChange.chunk);
+            continue;
+        }
+        int id = world.chunkId(chunkChange.chunk.chunk);
+        blockRenderer.removeChunk(id);
+        lightGrid.removeChunk(id);
+    }
+}
+
+// uploads the merged meshes of a streamed chunk, one batch per material, and
+// adds a light per lava block, all tagged so the chunk can be evicted again
+// ---------------------------------------------------------------------------------------------
+void Scene::addChunk(const StreamedChunk& chunk) {
+    int id = world.chunkId(chunk.chunk);
+    for (size_t i = 0; i < chunk.materials.size(); i++) {
+        const StreamedChunk::Material& material = chunk.materials[i];
+        blockRenderer.addStaticMesh(material.type, blockLayers[material.type], material.mesh,
+            glm::vec3(static_cast<float>(material.origin.x),
+                static_cast<float>(material.origin.y), 0.0f),
+            id);
+    }
+
+    glm::ivec2 first = world.file().origin() + chunk.chunk * TILE_CHUNK_SIZE;
+    unsigned char lava = TileMap::layerOf(LAVA);
+    for (int y = 0; y < TILE_CHUNK_SIZE; y++) {
+        for (int x = 0; x < TILE_CHUNK_SIZE; x++) {
+            if (!(chunk.layers[y * TILE_CHUNK_SIZE + x] & lava))
+                continue;
+            lightGrid.addLight(glm::vec3(static_cast<float>(first.x + x),
+                static_cast<float>(first.y + y), LAVA_LIGHT_DEPTH),
+                LAVA_LIGHT_RADIUS, LAVA_LIGHT_COLOR, id);
+        }
+    }
+}
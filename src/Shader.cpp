@@ -1,6 +1,48 @@
 #include <Shader.hpp>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+#include <MappedFile.hpp>
+#include <Profiler.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// cache file: header followed by the driver's program binary
+struct ProgramBinaryHeader {
+    char magic[8]; // "ICYPROG\0"
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+bool programBinarySupported() {
+    if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// chains text into an FNV-1a hash (see hashBytes), followed by a separator
+// so "ab" + "c" and "a" + "bc" differ
+void hashString(unsigned long long& hash, const char* text) {
+    const unsigned char separator = 0xff;
+    if (text)
+        hash = hashBytes(text, std::strlen(text), hash);
+    hash = hashBytes(&separator, 1, hash);
+}
+
+} // namespace
+
+unsigned int Shader::lookupCount = 0;
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath)
+    : ID(0), vertexFile(vertexPath), fragmentFile(fragmentPath),
+    binaryPath(programBinaryPath(vertexPath, fragmentPath, "")) {
 
     readShader(vertexPath, SHADER_TYPE::VERTEX);
     readShader(fragmentPath, SHADER_TYPE::FRAGMENT);
@@ -10,7 +52,10 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 
 // constructor using std::string
 // ------------------------------------------------------------------------
-Shader::Shader(const std::string vertexPath, const std::string fragmentPath) {
+Shader::Shader(const std::string vertexPath, const std::string fragmentPath,
+    const std::string& defines)
+    : ID(0), vertexFile(vertexPath), fragmentFile(fragmentPath), defines(defines),
+    binaryPath(programBinaryPath(vertexPath, fragmentPath, defines)) {
 
     readShader(vertexPath.c_str(), SHADER_TYPE::VERTEX);
     readShader(fragmentPath.c_str(), SHADER_TYPE::FRAGMENT);
@@ -18,6 +63,20 @@ Shader::Shader(const std::string vertexPath, const std::string fragmentPath) {
     compileShader();
 }
 
+// re-reads both sources; the running program is only replaced if the new one
+// compiles and links
+// ------------------------------------------------------------------------
+bool Shader::reload() {
+    readShader(vertexFile.c_str(), SHADER_TYPE::VERTEX);
+    readShader(fragmentFile.c_str(), SHADER_TYPE::FRAGMENT);
+
+    return compileShader();
+}
+
+bool Shader::dependsOn(const std::string& path) const {
+    return path == vertexFile || path == fragmentFile;
+}
+
 void Shader::readShader(char const* const shaderPath,
     Shader::SHADER_TYPE type) {
 
@@ -61,12 +120,37 @@ void Shader::readShader(char const* const shaderPath,
             << std::endl;
     }
 
+    // variant defines go right after "#version ..." which must stay first
+    if (!defines.empty()) {
+        size_t lineEnd = 0;
+        if (shaderCode.compare(0, 8, "#version") == 0) {
+            lineEnd = shaderCode.find('\n');
+            lineEnd = lineEnd == std::string::npos ? shaderCode.size() : lineEnd + 1;
+        }
+        shaderCode.insert(lineEnd, defines);
+    }
+
     *shaderCodePtr = shaderCode;
 
     return;
 }
 
-void Shader::compileShader() {
+bool Shader::compileShader() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool binarySupported = programBinarySupported();
+    unsigned long long key = binarySupported ? programKey() : 0;
+
+    // 1. a cached binary for exactly these sources on this driver
+    GLuint program = 0;
+    if (binarySupported && loadProgramBinary(key, program)) {
+        replaceProgram(program);
+        std::cout << "Shader " << binaryPath << ": cache hit, "
+            << std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count()
+            << " ms" << std::endl;
+        return true;
+    }
+
     // 2. compile shaders
     unsigned int vertex, fragment;
 
@@ -76,85 +160,317 @@ void Shader::compileShader() {
     vertex = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertex, 1, &vShdCode, nullptr);
     glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+    bool compiled = checkCompileErrors(vertex, "VERTEX");
 
     // fragment Shader
     GLchar const* fShdCode = this->fragmentShader.c_str();
     fragment = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(fragment, 1, &fShdCode, nullptr);
     glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+    compiled = checkCompileErrors(fragment, "FRAGMENT") && compiled;
 
     // shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    if (binarySupported)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    bool linked = checkCompileErrors(program, "PROGRAM");
     // delete the shaders as they're linked into our program now and no longer
     // necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    // a broken edit keeps the previous program running
+    if (!compiled || !linked) {
+        glDeleteProgram(program);
+        return false;
+    }
+    replaceProgram(program);
+
+    if (binarySupported)
+        saveProgramBinary(key);
+    std::cout << "Shader " << binaryPath << ": cache miss, compiled in "
+        << std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count()
+        << " ms" << std::endl;
+    return true;
+}
+
+// ------------------------------------------------------------------------
+void Shader::replaceProgram(GLuint program) {
+    if (ID != 0)
+        glDeleteProgram(ID);
+    ID = program;
+    cacheUniformLocations();
+}
+
+// "dir/material.vert" + "dir/material.frag" -> "material.<hash>.program" in
+// the cache directory (see cachePath); the fragment name is kept when the
+// two differ and variants get a hash of their defines
+// ------------------------------------------------------------------------
+std::string Shader::programBinaryPath(const std::string& vertexPath,
+    const std::string& fragmentPath, const std::string& defines) {
+    std::string vertexStem = vertexPath.substr(0, vertexPath.find_last_of('.'));
+    std::string fragmentStem =
+        fragmentPath.substr(0, fragmentPath.find_last_of('.'));
+    size_t vertexSlash = vertexStem.find_last_of("/\\");
+    size_t fragmentSlash = fragmentStem.find_last_of("/\\");
+    std::string vertexName = vertexSlash == std::string::npos
+        ? vertexStem : vertexStem.substr(vertexSlash + 1);
+    std::string fragmentName = fragmentSlash == std::string::npos
+        ? fragmentStem : fragmentStem.substr(fragmentSlash + 1);
+    std::string path = vertexStem;
+    if (vertexName != fragmentName)
+        path += "+" + fragmentName;
+    if (!defines.empty()) {
+        unsigned long long hash = FNV_OFFSET_BASIS;
+        hashString(hash, defines.c_str());
+        char variant[10];
+        std::snprintf(variant, sizeof(variant), ".%08x",
+            static_cast<unsigned int>(hash));
+        path += variant;
+    }
+    return cachePath(path, ".program");
+}
+
+// FNV-1a over the sources and the driver identification
+// ------------------------------------------------------------------------
+unsigned long long Shader::programKey() const {
+    unsigned long long hash = FNV_OFFSET_BASIS;
+    hashString(hash, vertexShader.c_str());
+    hashString(hash, fragmentShader.c_str());
+    hashString(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    hashString(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    hashString(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    return hash;
+}
+
+// false on a missing or stale file, or when the driver rejects the binary
+// ------------------------------------------------------------------------
+bool Shader::loadProgramBinary(unsigned long long key, GLuint& program) {
+    std::ifstream file(binaryPath.c_str(), std::ios::binary);
+    ProgramBinaryHeader header;
+    if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, "ICYPROG\0", 8) != 0 || header.key != key ||
+        header.length == 0)
+        return false;
+    // writes are atomic (see replaceFile), so a short file is a bug, not a
+    // race, and is reported rather than quietly recompiled
+    std::vector<char> binary(header.length);
+    if (!file.read(&binary[0], binary.size())) {
+        std::cout << "ERROR::SHADER::PROGRAM_BINARY_TRUNCATED " << binaryPath << std::endl;
+        return false;
+    }
+
+    program = glCreateProgram();
+    glProgramBinary(program, header.format, &binary[0], header.length);
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        program = 0;
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------
+void Shader::saveProgramBinary(unsigned long long key) const {
+    GLint success = 0, length = 0;
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!success || length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(ID, length, &length, &format, &binary[0]);
+
+    ProgramBinaryHeader header;
+    std::memcpy(header.magic, "ICYPROG\0", 8);
+    header.key = key;
+    header.format = format;
+    header.length = static_cast<uint32_t>(length);
+
+    // replaced as a whole, so another instance or a crash mid-write never
+    // leaves a truncated blob; a read-only install just compiles from source
+    // every time
+    const FilePart parts[] = { { &header, sizeof(header) }, { &binary[0], static_cast<size_t>(length) } };
+    replaceFile(binaryPath, parts, 2);
+}
+
+// fills the name -> location cache from the program's active uniforms. Arrays
+// are reported as "name[0]", so the bare name and every element are added too
+// ------------------------------------------------------------------------
+void Shader::cacheUniformLocations() {
+    uniformLocations.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), maxLength, &length,
+            &size, &type, &nameBuffer[0]);
+        std::string name(&nameBuffer[0], length);
+
+        // members of uniform blocks have no location
+        GLint location = glGetUniformLocation(ID, name.c_str());
+        if (location < 0)
+            continue;
+        uniformLocations[name] = location;
+
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            std::string base = name.substr(0, name.size() - 3);
+            uniformLocations[base] = location;
+            for (GLint element = 1; element < size; element++) {
+                std::string elementName =
+                    base + "[" + std::to_string(element) + "]";
+                uniformLocations[elementName] =
+                    glGetUniformLocation(ID, elementName.c_str());
+            }
+        }
+    }
 }
 
 // activate the shader
 // ------------------------------------------------------------------------
-void Shader::use() { glUseProgram(ID); }
+void Shader::use() {
+    glUseProgram(ID);
+    Profiler::count(COUNTER_STATE_CHANGES);
+}
+
+// ------------------------------------------------------------------------
+void Shader::bindUniformBlock(const std::string& blockName,
+    GLuint binding) const {
+    GLuint index = glGetUniformBlockIndex(ID, blockName.c_str());
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(ID, index, binding);
+}
+
+// ------------------------------------------------------------------------
+GLint Shader::getUniformLocation(const std::string& name) const {
+    lookupCount++;
+    std::unordered_map<std::string, GLint>::const_iterator it =
+        uniformLocations.find(name);
+    return it != uniformLocations.end() ? it->second : -1;
+}
+
+unsigned int Shader::uniformLookups() { return lookupCount; }
+
+void Shader::resetUniformLookups() { lookupCount = 0; }
+
+// typed uniform handles
+// ------------------------------------------------------------------------
+template <> void Uniform<bool>::set(const bool& value) const {
+    glUniform1i(location, static_cast<int>(value));
+    Profiler::count(COUNTER_UNIFORM_CALLS);
+}
+template <> void Uniform<int>::set(const int& value) const {
+    glUniform1i(location, value);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
+}
+template <> void Uniform<float>::set(const float& value) const {
+    glUniform1f(location, value);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
+}
+template <> void Uniform<glm::vec2>::set(const glm::vec2& value) const {
+    glUniform2fv(location, 1, &value[0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
+}
+template <> void Uniform<glm::vec3>::set(const glm::vec3& value) const {
+    glUniform3fv(location, 1, &value[0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
+}
+template <> void Uniform<glm::vec4>::set(const glm::vec4& value) const {
+    glUniform4fv(location, 1, &value[0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
+}
+template <> void Uniform<glm::mat2>::set(const glm::mat2& value) const {
+    glUniformMatrix2fv(location, 1, GL_FALSE, &value[0][0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
+}
+template <> void Uniform<glm::mat3>::set(const glm::mat3& value) const {
+    glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
+}
+template <> void Uniform<glm::mat4>::set(const glm::mat4& value) const {
+    glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
+}
 // utility uniform functions
 // ------------------------------------------------------------------------
 void Shader::setBool(const std::string& name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), static_cast<int>(value));
+    glUniform1i(getUniformLocation(name), static_cast<int>(value));
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 // ------------------------------------------------------------------------
 void Shader::setInt(const std::string& name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(getUniformLocation(name), value);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 // ------------------------------------------------------------------------
 void Shader::setFloat(const std::string& name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(getUniformLocation(name), value);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 
 // ------------------------------------------------------------------------
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform2fv(getUniformLocation(name), 1, &value[0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 void Shader::setVec2(const std::string& name, float x, float y) const {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    glUniform2f(getUniformLocation(name), x, y);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 // ------------------------------------------------------------------------
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(getUniformLocation(name), 1, &value[0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 void Shader::setVec3(const std::string& name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    glUniform3f(getUniformLocation(name), x, y, z);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 // ------------------------------------------------------------------------
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform4fv(getUniformLocation(name), 1, &value[0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 void Shader::setVec4(const std::string& name, float x, float y, float z,
     float w) const {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    glUniform4f(getUniformLocation(name), x, y, z, w);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+    glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE,
         &mat[0][0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE,
         &mat[0][0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE,
         &mat[0][0]);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
 }
 
 // utility function for checking shader compilation/linking errors.
 // ------------------------------------------------------------------------
-void Shader::checkCompileErrors(unsigned int shader, std::string type) {
+bool Shader::checkCompileErrors(unsigned int shader, std::string type) {
     int success;
     char infoLog[1024];
     if (type != "PROGRAM") {
@@ -179,4 +495,5 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type) {
                 << std::endl;
         }
     }
+    return success != 0;
 }
\ No newline at end of file
@@ -0,0 +1,285 @@
+#include <Simulation.hpp>
+
+#include <AabbKernel.hpp>
+#include <MappedFile.hpp>
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+// a step slides along one axis after the first face it reaches, so two
+// contacts cover a corner; as many passes push the player out of blocks
+// it already overlapped
+const int PLAYER_CONTACTS = 2;
+
+} // namespace
+
+constexpr float Simulation::playerScale;
+constexpr float Simulation::velocity;
+constexpr float Simulation::xStride;
+constexpr float Simulation::yJump;
+constexpr float Simulation::gravity;
+
+Simulation::Simulation(const Level& level)
+    : start(level.playerStart), lowMove(-FLT_MAX), highMove(FLT_MAX),
+    currentState('L'), tickCount(0), trace(nullptr) {
+    tiles.build(level.tiles);
+    if (!level.tiles.empty()) {
+        glm::ivec2 first(INT_MAX), last(INT_MIN);
+        for (size_t i = 0; i < level.tiles.size(); i++) {
+            glm::ivec2 cell(level.tiles[i].x, level.tiles[i].y);
+            first = glm::min(first, cell);
+            last = glm::max(last, cell);
+        }
+        setBounds(first, last);
+    }
+    for (size_t i = 0; i < level.actors.size(); i++) {
+        const ActorSpawn& actor = level.actors[i];
+        actors.spawn(static_cast<Entity_Kind>(actor.kind),
+            glm::vec2(actor.position[0], actor.position[1]),
+            glm::vec2(actor.velocity[0], actor.velocity[1]) * FIXED_TIMESTEP);
+    }
+    reset();
+}
+
+void Simulation::reset() {
+    playerState.move = glm::vec3(-0.125f, -0.125f, 0.0f);
+    playerState.xMovement = 0.0f;
+    playerState.yMovement = 0.0f;
+    playerState.isGrounded = true;
+    playerState.collision = false;
+    playerState.animationTick = 0;
+    lastMove = playerState.move;
+}
+
+// the player's box touches the inner faces of the wall cells at the bounds
+// ------------------------------------------------------------------------
+void Simulation::setBounds(const glm::ivec2& first, const glm::ivec2& last) {
+    glm::vec2 inset(0.5f + playerScale / 2);
+    lowMove = glm::vec2(first) + inset - glm::vec2(start);
+    highMove = glm::vec2(last) - inset - glm::vec2(start);
+}
+
+void Simulation::step(const TickInput& input, unsigned int ticks) {
+    lastMove = playerState.move;
+
+    if (input.events & RESET_EVENT)
+        respawn();
+    if (input.events & SWITCH_EVENT) {
+        currentState = currentState == 'L' ? 'I' : 'L';
+        traceEvent(TRACE_SWITCH);
+    }
+    if (input.events & JUMP_EVENT) {
+        if (playerState.isGrounded || playerState.collision) {
+            playerState.yMovement = yJump;
+            playerState.isGrounded = false;
+            traceEvent(TRACE_JUMP);
+        }
+    }
+
+    // animation frame
+    playerState.animationTick = (playerState.animationTick + ticks) % 80;
+
+    playerState.xMovement = input.x * xStride;
+    movePlayer(ticks);
+    if (!actors.empty())
+        interactWithActors(SOLID_LAYER | (currentState == 'L' ? LAVA_LAYER : ICE_LAYER), ticks);
+
+    tickCount += ticks;
+}
+
+// back to the start of the level without touching the world state
+// ------------------------------------------------------------------------
+void Simulation::respawn() {
+    playerState.move = glm::vec3(-0.125f, -0.125f, 0.0f);
+    playerState.isGrounded = true;
+    lastMove = playerState.move;
+    traceEvent(TRACE_RESET);
+}
+
+// advances the actors after the player has moved, then lands the player on
+// a platform it fell onto (and carries it along) or sends it back to the
+// start if it touches anything harmful
+// ------------------------------------------------------------------------
+void Simulation::interactWithActors(unsigned char activeLayers, unsigned int ticks) {
+    actors.step(tiles, activeLayers, ticks);
+
+    glm::vec3& move = playerState.move;
+    glm::vec2 half(playerScale / 2);
+    glm::vec2 center = glm::vec2(start) + glm::vec2(move);
+    int platform = actors.support(center - half, center + half, lastMove.y - move.y);
+    if (platform >= 0) {
+        move.x += actors.x[platform] - actors.previousX[platform];
+        move.y = actors.y[platform] + actors.halfY[platform] + half.y - start.y;
+        playerState.yMovement = 0.0f;
+        playerState.isGrounded = true;
+        center = glm::vec2(start) + glm::vec2(move);
+    }
+
+    if (actors.touchesHarmful(center - half, center + half))
+        respawn();
+}
+
+// sweeps the player along the ticks' displacement against the tile grid,
+// like EntityStore::integrate: each tick moves and then accelerates, so the
+// fall over n ticks is gravity * (0 + 1 + ... + n - 1). The player stops
+// exactly against the first face it reaches and slides along the other
+// axis; a floor grounds it, a floor or ceiling ends its vertical motion.
+// Blocks it already overlapped (switched on around it, or a platform
+// carried it in) are pushed out afterwards with the actors' kernel
+// ------------------------------------------------------------------------
+void Simulation::movePlayer(unsigned int ticks) {
+    glm::vec3& move = playerState.move;
+    float& yMovement = playerState.yMovement;
+    bool& isGrounded = playerState.isGrounded;
+    bool& collision = playerState.collision;
+    unsigned char activeLayers =
+        SOLID_LAYER | (currentState == 'L' ? LAVA_LAYER : ICE_LAYER);
+
+    float steps = static_cast<float>(ticks);
+    float fall = gravity * steps * (steps - 1.0f) * 0.5f;
+    glm::vec2 half(playerScale / 2);
+    glm::vec2 center = glm::vec2(start) + glm::vec2(move);
+    glm::vec2 delta(playerState.xMovement * steps, yMovement * steps - fall);
+    delta *= velocity;
+
+    int xCollisionType = 0;
+    int yCollisionType = 0;
+    Trace_Stop_Reason stopReason = STOP_NONE;
+    bool stopped = false;
+    bool overlapping = false;
+    isGrounded = false;
+    for (int contact = 0; contact < PLAYER_CONTACTS && delta != glm::vec2(0.0f); contact++) {
+        Tile_Sweep hit = tiles.sweep(center, half, delta, activeLayers);
+        overlapping |= hit.overlapping;
+        center += delta * hit.time;
+        if (hit.time >= 1.0f)
+            break;
+        collision = true;
+        delta *= 1.0f - hit.time;
+        if (hit.normal.x != 0.0f) {
+            center.x = static_cast<float>(hit.cell.x) + hit.normal.x * (half.x + 0.5f);
+            delta.x = 0.0f;
+            xCollisionType = hit.normal.x < 0.0f ? 1 : 3;
+            continue;
+        }
+        center.y = static_cast<float>(hit.cell.y) + hit.normal.y * (half.y + 0.5f);
+        delta.y = 0.0f;
+        stopped = true;
+        isGrounded = hit.normal.y > 0.0f;
+        yCollisionType = isGrounded ? 3 : 1;
+        stopReason = isGrounded ? STOP_STANDING : STOP_HEAD;
+    }
+
+    for (int pass = 0; overlapping && pass <= PLAYER_CONTACTS; pass++) {
+        int cellX = 0, cellY = 0;
+        overlapping = tiles.firstOverlap(center - half, center + half, activeLayers,
+            cellX, cellY);
+        if (!overlapping)
+            break;
+        if (pass == PLAYER_CONTACTS) {
+            traceEvent(TRACE_MOVEMENT_ERROR, xCollisionType, yCollisionType);
+            break;
+        }
+        float previousY = start.y + lastMove.y;
+        float tileX = static_cast<float>(cellX);
+        float tileY = static_cast<float>(cellY);
+        float xVelocity = 0.0f;
+        unsigned char contact = 0;
+        AabbBatch box = { 1, &center.x, &center.y, &previousY, &half.x, &half.y,
+            &xVelocity, &yMovement };
+        float before = center.y;
+        resolveTileContacts(box, &tileX, &tileY, &contact);
+        collision = true;
+        if (center.y == before) {
+            xCollisionType = 2;
+            continue;
+        }
+        stopped = true;
+        isGrounded = (contact & CONTACT_GROUND) != 0;
+        yCollisionType = 2;
+        stopReason = isGrounded ? STOP_STANDING : STOP_HEAD;
+    }
+
+    // the level's wall, also where its chunks are not resident yet
+    glm::vec2 moved = glm::clamp(center - glm::vec2(start), lowMove, highMove);
+    if (moved.y <= lowMove.y && !isGrounded) {
+        isGrounded = true;
+        stopped = true;
+        stopReason = STOP_GROUND;
+    }
+    move.x = moved.x;
+    move.y = moved.y;
+
+    traceEvent(TRACE_TICK, xCollisionType, yCollisionType, stopReason);
+
+    // a stopped player starts falling again on its last tick only
+    if (stopped)
+        yMovement = 0.0f;
+    yMovement -= gravity * (stopped ? 1.0f : steps);
+    playerState.xMovement = 0.0f;
+    collision = false;
+}
+
+// snapshot of the player for the trace ring; compiled out with ICYHOT_TRACE=0
+// ------------------------------------------------------------------------
+void Simulation::traceEvent(Trace_Event_Type type, int xCollisionType,
+    int yCollisionType, Trace_Stop_Reason stopReason) {
+#if ICYHOT_TRACE
+    if (!trace || !trace->enabled())
+        return;
+    TraceEvent event;
+    event.tick = tickCount;
+    event.x = playerState.move.x;
+    event.y = playerState.move.y;
+    event.yMovement = playerState.yMovement;
+    event.type = static_cast<unsigned char>(type);
+    event.xCollisionType = static_cast<unsigned char>(xCollisionType);
+    event.yCollisionType = static_cast<unsigned char>(yCollisionType);
+    event.stopReason = static_cast<unsigned char>(stopReason);
+    event.isGrounded = playerState.isGrounded;
+    event.collision = playerState.collision;
+    event.state = static_cast<unsigned char>(currentState);
+    event.padding = 0;
+    trace->record(event);
+#else
+    (void)type;
+    (void)xCollisionType;
+    (void)yCollisionType;
+    (void)stopReason;
+#endif
+}
+
+// ------------------------------------------------------------------------
+namespace {
+
+template <typename T> void hashValue(unsigned long long& hash, const T& value) {
+    hash = hashBytes(&value, sizeof(T), hash);
+}
+
+} // namespace
+
+unsigned long long Simulation::hash() const {
+    unsigned long long hash = FNV_OFFSET_BASIS;
+    hashValue(hash, playerState.move.x);
+    hashValue(hash, playerState.move.y);
+    hashValue(hash, playerState.move.z);
+    hashValue(hash, playerState.xMovement);
+    hashValue(hash, playerState.yMovement);
+    hashValue(hash, playerState.isGrounded);
+    hashValue(hash, playerState.collision);
+    hashValue(hash, playerState.animationTick);
+    hashValue(hash, currentState);
+    hashValue(hash, tickCount);
+    for (size_t i = 0; i < actors.size(); i++) {
+        hashValue(hash, actors.x[i]);
+        hashValue(hash, actors.y[i]);
+        hashValue(hash, actors.velocityX[i]);
+        hashValue(hash, actors.velocityY[i]);
+        hashValue(hash, actors.flags[i]);
+        hashValue(hash, actors.frame[i]);
+    }
+    return hash;
+}
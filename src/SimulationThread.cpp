@@ -0,0 +1,224 @@
+#include <SimulationThread.hpp>
+
+#include <Level.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// a burst of key changes or streamed chunks larger than this waits a tick
+const size_t INPUT_QUEUE_CAPACITY = 256;
+const size_t CHUNK_QUEUE_CAPACITY = 64;
+// two scopes per batch of ticks, a few frames' worth
+const size_t SCOPE_QUEUE_CAPACITY = 256;
+
+// a streamed level starts with an empty collision grid covering the level;
+// LevelStream installs the chunks around the player
+Simulation streamedSimulation(const LevelFile& file) {
+    Level level;
+    level.playerStart = file.playerStart();
+    file.actors(level.actors);
+    Simulation simulation(level);
+    simulation.setBounds(file.origin(), file.origin() + file.size() - 1);
+    simulation.tileMap().reset(file.origin(), file.chunksX(), file.chunksY());
+    return simulation;
+}
+
+} // namespace
+
+SimulationThread::SimulationThread(size_t streamBudget, const bool* occluders)
+    : levelStream(streamBudget), sim(Level()), trace(nullptr), recording(nullptr),
+    accumulator(0.0f), epoch(std::chrono::steady_clock::now()), simulated(0.0),
+    hasPending(false), inputs(INPUT_QUEUE_CAPACITY), chunks(CHUNK_QUEUE_CAPACITY),
+    scopes(SCOPE_QUEUE_CAPACITY), stopping(false) {
+    for (unsigned int i = 0; i < BLOCK_TYPE_COUNT; i++)
+        this->occluders[i] = occluders[i];
+    held.x = 0;
+    held.events = 0;
+}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+// the camera looks at the level from the front, so rear faces are dropped
+// ------------------------------------------------------------------------
+bool SimulationThread::open(const std::string& compiledPath) {
+    bool wasRunning = running();
+    stop();
+    if (!levelStream.open(compiledPath, occluders, false)) {
+        if (wasRunning)
+            start();
+        return false;
+    }
+
+    sim = streamedSimulation(levelStream.file());
+    sim.setTrace(trace);
+    accumulator = 0.0f;
+    held.x = 0;
+    held.events = 0;
+    hasPending = false;
+    unsent.clear();
+    // with the thread stopped this side may drain both queues
+    InputEvent event;
+    while (inputs.pop(event)) {
+    }
+    ChunkChange change;
+    while (chunks.pop(change)) {
+    }
+    ThreadScope scope;
+    while (scopes.pop(scope)) {
+    }
+
+    publish(0.0);
+    if (wasRunning)
+        start();
+    return true;
+}
+
+void SimulationThread::setTrace(TraceRing* ring) {
+    trace = ring;
+    sim.setTrace(ring);
+}
+
+void SimulationThread::advance(float deltaTime, TickInput& input, Profiler& profiler) {
+    // the chunks around the player are resident before the ticks run
+    profiler.beginScope("streaming");
+    stream();
+    profiler.endScope();
+
+    // a long hitch is clamped so the simulation cannot spiral trying to
+    // catch up
+    profiler.beginScope("physics");
+    accumulator += std::min(deltaTime, MAX_FRAME_TIME);
+    while (accumulator >= FIXED_TIMESTEP) {
+        tick(input);
+        // events fire once, the direction stays held
+        input.events = 0;
+        accumulator -= FIXED_TIMESTEP;
+    }
+    publish(static_cast<double>(sim.tick()) * FIXED_TIMESTEP);
+    profiler.endScope();
+}
+
+void SimulationThread::start() {
+    if (running())
+        return;
+    stopping.store(false, std::memory_order_relaxed);
+    simulated = now();
+    worker = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    if (!running())
+        return;
+    stopping.store(true, std::memory_order_relaxed);
+    worker.join();
+}
+
+double SimulationThread::now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+// wakes once per tick: streams, runs every tick that is due, publishes the
+// result and sleeps until the next tick is due. Ticks stay on the fixed
+// grid of the simulation clock, however late the thread wakes: a hitch
+// longer than MAX_FRAME_TIME drops whole ticks. The streaming and the ticks
+// are timed for the renderer's profiler
+// ------------------------------------------------------------------------
+void SimulationThread::run() {
+    while (!stopping.load(std::memory_order_relaxed)) {
+        double current = now();
+        if (simulated < current - MAX_FRAME_TIME)
+            simulated += std::floor((current - MAX_FRAME_TIME - simulated) / FIXED_TIMESTEP) *
+                FIXED_TIMESTEP;
+        if (simulated + FIXED_TIMESTEP <= current) {
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            stream();
+            std::chrono::steady_clock::time_point streamed = std::chrono::steady_clock::now();
+            do {
+                applyInput(simulated + FIXED_TIMESTEP);
+                tick(held);
+                held.events = 0;
+                simulated += FIXED_TIMESTEP;
+            } while (simulated + FIXED_TIMESTEP <= current);
+            publish(simulated);
+            timed("streaming", begin, streamed);
+            timed("physics", streamed, std::chrono::steady_clock::now());
+        }
+        std::this_thread::sleep_until(epoch + std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(simulated + FIXED_TIMESTEP)));
+    }
+}
+
+// folds every event stamped before until into the held input; the first one
+// that is not due yet is kept back for a later tick
+// ------------------------------------------------------------------------
+void SimulationThread::applyInput(double until) {
+    for (;;) {
+        if (!hasPending && !inputs.pop(pending))
+            return;
+        hasPending = true;
+        if (pending.time >= until)
+            return;
+        held.x = pending.x;
+        held.events |= pending.events;
+        hasPending = false;
+    }
+}
+
+// installs finished chunks into the collision grid and queues them, with
+// the evicted ones, for the renderer in the order they happened
+// ------------------------------------------------------------------------
+void SimulationThread::stream() {
+    loaded.clear();
+    evicted.clear();
+    levelStream.update(sim.playerStart() + sim.player().move,
+        sim.player().move - sim.previousMove(), sim.tileMap(), loaded, evicted);
+    for (size_t i = 0; i < loaded.size(); i++) {
+        unsent.push_back(ChunkChange());
+        unsent.back().evicted = false;
+        unsent.back().chunk = std::move(loaded[i]);
+    }
+    for (size_t i = 0; i < evicted.size(); i++) {
+        unsent.push_back(ChunkChange());
+        unsent.back().evicted = true;
+        unsent.back().chunk.chunk = evicted[i];
+    }
+    while (!unsent.empty() && chunks.push(unsent.front()))
+        unsent.pop_front();
+}
+
+void SimulationThread::tick(const TickInput& input) {
+    sim.step(input);
+    if (recording)
+        recording->push_back(input);
+}
+
+// the slot coming back from the triple buffer holds an older snapshot whose
+// vectors are reused
+// ------------------------------------------------------------------------
+void SimulationThread::publish(double time) {
+    WorldSnapshot& snapshot = snapshots.writeSlot();
+    const PlayerState& player = sim.player();
+    snapshot.tick = sim.tick();
+    snapshot.time = time;
+    snapshot.playerStart = sim.playerStart();
+    snapshot.move = player.move;
+    snapshot.previousMove = sim.previousMove();
+    snapshot.animationTick = player.animationTick;
+    snapshot.state = sim.state();
+    sim.entities().snapshot(snapshot.actors);
+    snapshot.residentChunks = levelStream.residentChunks();
+    snapshot.residentBytes = levelStream.residentBytes();
+    snapshot.streamingStalls = levelStream.stalls();
+    snapshots.publish();
+}
+
+void SimulationThread::timed(const char* name, std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end) {
+    ThreadScope scope = { name, start, std::chrono::duration<double>(end - start).count() };
+    scopes.push(scope);
+}
@@ -0,0 +1,177 @@
+#include <StaticGeometry.hpp>
+
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+void addQuad(MeshData& mesh, const glm::vec3 (&corners)[4],
+    const glm::vec2 (&uvs)[4], const glm::vec3& normal) {
+    unsigned int base = static_cast<unsigned int>(mesh.vertices.size());
+    for (int i = 0; i < 4; i++) {
+        MeshVertex vertex = { corners[i], normal, uvs[i] };
+        mesh.vertices.push_back(vertex);
+    }
+    const unsigned int quad[6] = { 0, 1, 2, 2, 3, 0 };
+    for (int i = 0; i < 6; i++)
+        mesh.indices.push_back(base + quad[i]);
+}
+
+} // namespace
+
+StaticGeometry::StaticGeometry(const std::vector<Tile>& tiles,
+    const bool* occluders, bool backFaces)
+    : backFaces(backFaces), minX(0), minY(0), width(0), height(0) {
+    for (unsigned int i = 0; i < BLOCK_TYPE_COUNT; i++)
+        this->occluders[i] = occluders[i];
+    if (tiles.empty())
+        return;
+
+    int maxX = INT_MIN, maxY = INT_MIN;
+    minX = minY = INT_MAX;
+    for (size_t i = 0; i < tiles.size(); i++) {
+        minX = std::min(minX, tiles[i].x);
+        minY = std::min(minY, tiles[i].y);
+        maxX = std::max(maxX, tiles[i].x);
+        maxY = std::max(maxY, tiles[i].y);
+    }
+    minX -= 1;
+    minY -= 1;
+    width = maxX - minX + 2;
+    height = maxY - minY + 2;
+    cells.assign(static_cast<size_t>(width) * height, -1);
+    for (size_t i = 0; i < tiles.size(); i++) {
+        size_t index = static_cast<size_t>(tiles[i].y - minY) * width +
+            (tiles[i].x - minX);
+        cells[index] = static_cast<signed char>(tiles[i].type);
+    }
+}
+
+glm::ivec2 StaticGeometry::minCell() const {
+    return glm::ivec2(minX + 1, minY + 1);
+}
+
+glm::ivec2 StaticGeometry::maxCell() const {
+    return glm::ivec2(minX + width - 2, minY + height - 2);
+}
+
+int StaticGeometry::at(int x, int y) const {
+    return cells[static_cast<size_t>(y - minY) * width + (x - minX)];
+}
+
+// a face is exposed unless the neighbour in that direction hides it
+// ------------------------------------------------------------------------
+bool StaticGeometry::exposed(Block_Type type, int x, int y, int dx, int dy) const {
+    if (at(x, y) != type)
+        return false;
+    int neighbour = at(x + dx, y + dy);
+    return neighbour < 0 || (neighbour != type && !occluders[neighbour]);
+}
+
+MeshData StaticGeometry::build(Block_Type type, const glm::ivec2& first,
+    const glm::ivec2& last, glm::ivec2& origin) const {
+    MeshData mesh;
+    origin = first;
+
+    // clamp to the cells inside the border
+    const int x0 = std::max(first.x, minX + 1), x1 = std::min(last.x, minX + width - 2) + 1;
+    const int y0 = std::max(first.y, minY + 1), y1 = std::min(last.y, minY + height - 2) + 1;
+    if (cells.empty() || x0 >= x1 || y0 >= y1)
+        return mesh;
+
+    // cell edges relative to the origin cell's centre
+    const glm::vec2 offset = glm::vec2(origin) + glm::vec2(0.5f);
+
+    // 1. front and back: greedy rectangles over the material's cells
+    const int rangeWidth = x1 - x0;
+    std::vector<bool> used(static_cast<size_t>(rangeWidth) * (y1 - y0), false);
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            size_t start = static_cast<size_t>(y - y0) * rangeWidth + (x - x0);
+            if (at(x, y) != type || used[start])
+                continue;
+
+            int w = 1;
+            while (x + w < x1 && at(x + w, y) == type && !used[start + w])
+                w++;
+            int h = 1;
+            for (bool grow = true; grow && y + h < y1; ) {
+                size_t row = start + static_cast<size_t>(h) * rangeWidth;
+                for (int i = 0; i < w && grow; i++)
+                    grow = at(x + i, y + h) == type && !used[row + i];
+                if (grow)
+                    h++;
+            }
+            for (int j = 0; j < h; j++)
+                for (int i = 0; i < w; i++)
+                    used[start + static_cast<size_t>(j) * rangeWidth + i] = true;
+
+            float xa = x - offset.x, xb = xa + w;
+            float ya = y - offset.y, yb = ya + h;
+            const glm::vec2 uvs[4] = { glm::vec2(0.0f, 0.0f), glm::vec2(w, 0.0f),
+                glm::vec2(w, h), glm::vec2(0.0f, h) };
+            const glm::vec3 front[4] = { glm::vec3(xa, ya, 0.5f), glm::vec3(xb, ya, 0.5f),
+                glm::vec3(xb, yb, 0.5f), glm::vec3(xa, yb, 0.5f) };
+            addQuad(mesh, front, uvs, glm::vec3(0.0f, 0.0f, 1.0f));
+            if (backFaces) {
+                const glm::vec3 back[4] = { glm::vec3(xa, ya, -0.5f), glm::vec3(xb, ya, -0.5f),
+                    glm::vec3(xb, yb, -0.5f), glm::vec3(xa, yb, -0.5f) };
+                addQuad(mesh, back, uvs, glm::vec3(0.0f, 0.0f, -1.0f));
+            }
+        }
+    }
+
+    // 2. top and bottom: runs along x within each row
+    for (int side = -1; side <= 1; side += 2) {
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; ) {
+                if (!exposed(type, x, y, 0, side)) {
+                    x++;
+                    continue;
+                }
+                int length = 1;
+                while (x + length < x1 && exposed(type, x + length, y, 0, side))
+                    length++;
+
+                float xa = x - offset.x, xb = xa + length;
+                float yFace = y - offset.y + (side > 0 ? 1.0f : 0.0f);
+                const glm::vec3 corners[4] = { glm::vec3(xa, yFace, -0.5f),
+                    glm::vec3(xb, yFace, -0.5f), glm::vec3(xb, yFace, 0.5f),
+                    glm::vec3(xa, yFace, 0.5f) };
+                const glm::vec2 uvs[4] = { glm::vec2(0.0f, 1.0f),
+                    glm::vec2(length, 1.0f), glm::vec2(length, 0.0f),
+                    glm::vec2(0.0f, 0.0f) };
+                addQuad(mesh, corners, uvs, glm::vec3(0.0f, side, 0.0f));
+                x += length;
+            }
+        }
+    }
+
+    // 3. left and right: runs along y within each column
+    for (int side = -1; side <= 1; side += 2) {
+        for (int x = x0; x < x1; x++) {
+            for (int y = y0; y < y1; ) {
+                if (!exposed(type, x, y, side, 0)) {
+                    y++;
+                    continue;
+                }
+                int length = 1;
+                while (y + length < y1 && exposed(type, x, y + length, side, 0))
+                    length++;
+
+                float ya = y - offset.y, yb = ya + length;
+                float xFace = x - offset.x + (side > 0 ? 1.0f : 0.0f);
+                const glm::vec3 corners[4] = { glm::vec3(xFace, yb, 0.5f),
+                    glm::vec3(xFace, yb, -0.5f), glm::vec3(xFace, ya, -0.5f),
+                    glm::vec3(xFace, ya, 0.5f) };
+                const glm::vec2 uvs[4] = { glm::vec2(length, 0.0f),
+                    glm::vec2(length, 1.0f), glm::vec2(0.0f, 1.0f),
+                    glm::vec2(0.0f, 0.0f) };
+                addQuad(mesh, corners, uvs, glm::vec3(side, 0.0f, 0.0f));
+                y += length;
+            }
+        }
+    }
+
+    return mesh;
+}
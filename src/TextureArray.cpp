@@ -0,0 +1,222 @@
+#include <TextureArray.hpp>
+
+#include <Profiler.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - begin).count();
+}
+
+GLenum compressedFormat(Texture_Compression compression) {
+    return compression == BC3_COMPRESSION ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                                          : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+} // namespace
+
+TextureArray::TextureArray(int width, int height, bool alpha)
+    : ID(0), width(width), height(height), alpha(alpha), format(UNCOMPRESSED) {
+    glGenTextures(1, &ID);
+    PBOs[0] = PBOs[1] = 0;
+}
+
+TextureArray::~TextureArray() { glDeleteTextures(1, &ID); }
+
+unsigned int TextureArray::addLayer(const std::string& path) {
+    paths.push_back(path);
+    return static_cast<unsigned int>(paths.size() - 1);
+}
+
+void TextureArray::upload(unsigned int threadCount) {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    const unsigned int layers = layerCount();
+
+    // block formats need whole 4x4 blocks at the top level
+    format = UNCOMPRESSED;
+    if (GLAD_GL_EXT_texture_compression_s3tc && width % 4 == 0 && height % 4 == 0)
+        format = alpha ? BC3_COMPRESSION : BC1_COMPRESSION;
+
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, std::max(1u, layers));
+
+    layerTimings.assign(layers, LayerTiming());
+    std::vector<std::vector<unsigned char> > data(layers);
+
+    // workers claim layers in order and hand finished ones to the GL thread
+    std::atomic<unsigned int> nextLayer(0);
+    std::mutex readyMutex;
+    std::condition_variable readyCondition;
+    std::vector<unsigned int> ready;
+
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threadCount; t++) {
+        workers.push_back(std::thread([&]() {
+            for (unsigned int layer = nextLayer++; layer < layers;
+                layer = nextLayer++) {
+                std::chrono::steady_clock::time_point start =
+                    std::chrono::steady_clock::now();
+                bool cached = false;
+                prepareLayer(layer, data[layer], cached);
+                layerTimings[layer].path = paths[layer];
+                layerTimings[layer].decode = millisecondsSince(start);
+                layerTimings[layer].cached = cached;
+
+                std::lock_guard<std::mutex> lock(readyMutex);
+                ready.push_back(layer);
+                readyCondition.notify_one();
+            }
+        }));
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+    allocate(layers);
+
+    for (unsigned int uploaded = 0; uploaded < layers; uploaded++) {
+        unsigned int layer;
+        {
+            std::unique_lock<std::mutex> lock(readyMutex);
+            readyCondition.wait(lock, [&]() { return !ready.empty(); });
+            layer = ready.back();
+            ready.pop_back();
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBOs[uploaded % 2]);
+        uploadLayer(layer, data[layer]);
+        std::vector<unsigned char>().swap(data[layer]);
+        layerTimings[layer].upload = millisecondsSince(start);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(2, PBOs);
+
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+
+    if (format == UNCOMPRESSED)
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+        GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    for (unsigned int layer = 0; layer < layers; layer++)
+        std::cout << "Texture " << layerTimings[layer].path
+            << (layerTimings[layer].cached ? " (cached)" : "") << ": decode "
+            << layerTimings[layer].decode << " ms, upload "
+            << layerTimings[layer].upload << " ms" << std::endl;
+    std::cout << "Textures: " << layers << " layers"
+        << (format == BC3_COMPRESSION ? " BC3" : format == BC1_COMPRESSION ? " BC1" : "")
+        << " on " << threadCount << " threads in " << millisecondsSince(begin)
+        << " ms" << std::endl;
+}
+
+bool TextureArray::reloadLayer(const std::string& path) {
+    if (std::find(paths.begin(), paths.end(), path) == paths.end())
+        return false;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+    glGenBuffers(1, PBOs);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBOs[0]);
+    for (unsigned int layer = 0; layer < layerCount(); layer++) {
+        if (paths[layer] != path)
+            continue;
+        std::vector<unsigned char> data;
+        bool cached = false;
+        prepareLayer(layer, data, cached);
+        uploadLayer(layer, data);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, PBOs);
+
+    if (format == UNCOMPRESSED)
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    return true;
+}
+
+void TextureArray::bind(GLenum unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+    Profiler::count(COUNTER_TEXTURE_BINDS);
+}
+
+// RGBA8 top level, or the compressed chain through the on-disk cache; safe to
+// call from worker threads
+// ------------------------------------------------------------------------
+void TextureArray::prepareLayer(unsigned int layer,
+    std::vector<unsigned char>& data, bool& cached) const {
+    cached = false;
+    if (format == UNCOMPRESSED)
+        decodeImage(paths[layer], width, height, data);
+    else
+        loadCompressedTexture(paths[layer], width, height, format, data, cached);
+}
+
+// storage for all layers; compressed arrays get their whole mip chain here,
+// uncompressed ones only the top level and glGenerateMipmap fills the rest
+// ------------------------------------------------------------------------
+void TextureArray::allocate(unsigned int layers) {
+    if (format == UNCOMPRESSED) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0,
+            GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    else {
+        unsigned int levels = mipLevelCount(width, height);
+        for (unsigned int level = 0; level < levels; level++)
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level,
+                compressedFormat(format), std::max(1, width >> level),
+                std::max(1, height >> level), layers, 0,
+                static_cast<GLsizei>(mipLevelSize(width, height, level, format) * layers),
+                nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    }
+
+    // two pixel buffers in turn, so filling one does not wait on the driver
+    // still reading the other
+    glGenBuffers(2, PBOs);
+}
+
+// copies one layer (top level or whole compressed chain) into the bound pixel
+// buffer and points the texture upload at it
+// ------------------------------------------------------------------------
+void TextureArray::uploadLayer(unsigned int layer,
+    const std::vector<unsigned char>& data) {
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, data.size(), nullptr, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, data.size(),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        std::memcpy(mapped, &data[0], data.size());
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // with the pixel buffer bound the pointers are offsets into it
+    if (format == UNCOMPRESSED) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, mapped ? (void*)0 : &data[0]);
+        return;
+    }
+    size_t offset = 0;
+    for (unsigned int level = 0; level < mipLevelCount(width, height); level++) {
+        size_t size = mipLevelSize(width, height, level, format);
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+            std::max(1, width >> level), std::max(1, height >> level), 1,
+            compressedFormat(format), static_cast<GLsizei>(size),
+            mapped ? (void*)offset : &data[offset]);
+        offset += size;
+    }
+}
@@ -0,0 +1,186 @@
+#include <TextureCache.hpp>
+
+#include <MappedFile.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize.h>
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const uint32_t COOKED_TEXTURE_VERSION = 1;
+
+// cache file: header followed by every mip level, largest first
+struct CookedTextureHeader {
+    char magic[8]; // "ICYTEX\0\0"
+    uint32_t version;
+    uint32_t compression;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+    uint32_t padding;
+    uint64_t sourceHash;
+};
+
+std::string cookedPath(const std::string& path, Texture_Compression compression) {
+    return cachePath(path, compression == BC3_COMPRESSION ? ".bc3" : ".bc1");
+}
+
+int levelExtent(int extent, unsigned int level) {
+    return std::max(1, extent >> level);
+}
+
+// compresses one RGBA8 level into 4x4 blocks; blocks that hang over the edge
+// of small levels repeat the last row and column
+void compressLevel(const unsigned char* pixels, int width, int height,
+    Texture_Compression compression, unsigned char* blocks) {
+    const int alpha = compression == BC3_COMPRESSION ? 1 : 0;
+    const size_t blockSize = alpha ? 16 : 8;
+    unsigned char block[4 * 4 * 4];
+    for (int by = 0; by < height; by += 4) {
+        for (int bx = 0; bx < width; bx += 4) {
+            for (int y = 0; y < 4; y++) {
+                for (int x = 0; x < 4; x++) {
+                    int sx = std::min(bx + x, width - 1);
+                    int sy = std::min(by + y, height - 1);
+                    std::memcpy(&block[(y * 4 + x) * 4],
+                        &pixels[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+                }
+            }
+            stb_compress_dxt_block(blocks, block, alpha, STB_DXT_HIGHQUAL);
+            blocks += blockSize;
+        }
+    }
+}
+
+bool cook(const std::string& path, int width, int height,
+    Texture_Compression compression, std::vector<unsigned char>& mips) {
+    std::vector<unsigned char> level;
+    bool decoded = decodeImage(path, width, height, level);
+
+    unsigned int levels = mipLevelCount(width, height);
+    size_t total = 0;
+    for (unsigned int i = 0; i < levels; i++)
+        total += mipLevelSize(width, height, i, compression);
+    mips.resize(total);
+
+    // every level is filtered down from the previous one
+    size_t offset = 0;
+    std::vector<unsigned char> next;
+    for (unsigned int i = 0; i < levels; i++) {
+        int levelWidth = levelExtent(width, i);
+        int levelHeight = levelExtent(height, i);
+        if (i > 0) {
+            next.resize(static_cast<size_t>(levelWidth) * levelHeight * 4);
+            stbir_resize_uint8(&level[0], levelExtent(width, i - 1),
+                levelExtent(height, i - 1), 0, &next[0], levelWidth, levelHeight,
+                0, 4);
+            level.swap(next);
+        }
+        compressLevel(&level[0], levelWidth, levelHeight, compression,
+            &mips[offset]);
+        offset += mipLevelSize(width, height, i, compression);
+    }
+    return decoded;
+}
+
+} // namespace
+
+bool decodeImage(const std::string& path, int width, int height,
+    std::vector<unsigned char>& pixels) {
+    const size_t size = static_cast<size_t>(width) * height * 4;
+    pixels.assign(size, 0);
+
+    int imageWidth, imageHeight, nrComponents;
+    unsigned char* data = stbi_load(path.c_str(), &imageWidth, &imageHeight,
+        &nrComponents, 4);
+    if (!data) {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        return false;
+    }
+    if (imageWidth == width && imageHeight == height)
+        std::memcpy(&pixels[0], data, size);
+    else
+        stbir_resize_uint8(data, imageWidth, imageHeight, 0, &pixels[0], width,
+            height, 0, 4);
+    stbi_image_free(data);
+    return true;
+}
+
+unsigned int mipLevelCount(int width, int height) {
+    unsigned int levels = 1;
+    for (int extent = std::max(width, height); extent > 1; extent >>= 1)
+        levels++;
+    return levels;
+}
+
+size_t mipLevelSize(int width, int height, unsigned int level,
+    Texture_Compression compression) {
+    size_t levelWidth = static_cast<size_t>(levelExtent(width, level));
+    size_t levelHeight = static_cast<size_t>(levelExtent(height, level));
+    if (compression == UNCOMPRESSED)
+        return levelWidth * levelHeight * 4;
+    size_t blocks = ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4);
+    return blocks * (compression == BC3_COMPRESSION ? 16 : 8);
+}
+
+bool loadCompressedTexture(const std::string& path, int width, int height,
+    Texture_Compression compression, std::vector<unsigned char>& mips,
+    bool& cached) {
+    cached = false;
+
+    // a source that cannot be read still gets a (black) chain, but no cache
+    unsigned long long sourceHash = 0;
+    if (!fileHash(path, sourceHash))
+        return cook(path, width, height, compression, mips);
+
+    const std::string cacheFile = cookedPath(path, compression);
+    MappedFile cache;
+    if (cache.open(cacheFile) && cache.size() >= sizeof(CookedTextureHeader)) {
+        const CookedTextureHeader* header =
+            reinterpret_cast<const CookedTextureHeader*>(cache.data());
+        size_t expected = sizeof(CookedTextureHeader);
+        for (unsigned int i = 0; i < mipLevelCount(width, height); i++)
+            expected += mipLevelSize(width, height, i, compression);
+        if (std::memcmp(header->magic, "ICYTEX\0\0", 8) == 0 &&
+            header->version == COOKED_TEXTURE_VERSION &&
+            header->compression == static_cast<uint32_t>(compression) &&
+            header->width == static_cast<uint32_t>(width) &&
+            header->height == static_cast<uint32_t>(height) &&
+            header->levels == mipLevelCount(width, height) &&
+            header->sourceHash == sourceHash && cache.size() == expected) {
+            mips.assign(cache.data() + sizeof(CookedTextureHeader),
+                cache.data() + cache.size());
+            cached = true;
+            return true;
+        }
+    }
+    cache.close();
+
+    if (!cook(path, width, height, compression, mips))
+        return false;
+
+    CookedTextureHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "ICYTEX\0\0", 8);
+    header.version = COOKED_TEXTURE_VERSION;
+    header.compression = static_cast<uint32_t>(compression);
+    header.width = static_cast<uint32_t>(width);
+    header.height = static_cast<uint32_t>(height);
+    header.levels = mipLevelCount(width, height);
+    header.sourceHash = sourceHash;
+
+    // other workers or instances may be mapping the old file; a read-only
+    // install just cooks again on the next run
+    const FilePart parts[] = { { &header, sizeof(header) }, { &mips[0], mips.size() } };
+    replaceFile(cacheFile, parts, 2);
+    return true;
+}
@@ -0,0 +1,208 @@
+#include <TileMap.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// boxes closer than this to a cell count as touching it rather than
+// overlapping, so one resting on a block keeps being stopped by it
+const float SWEEP_SKIN = 1e-4f;
+
+// entry and exit fraction of delta for one axis of the box centred at
+// center against the cell spanning [low, high] widened by the box
+void slab(float center, float delta, float low, float high, float& entry, float& exit) {
+    if (delta == 0.0f) {
+        bool inside = center > low && center < high;
+        entry = inside ? -std::numeric_limits<float>::infinity() :
+            std::numeric_limits<float>::infinity();
+        exit = std::numeric_limits<float>::infinity();
+        return;
+    }
+    float first = (low - center) / delta;
+    float second = (high - center) / delta;
+    entry = std::min(first, second);
+    exit = std::max(first, second);
+}
+
+} // namespace
+
+TileMap::TileMap() : originX(0), originY(0), chunkColumns(0), chunkRows(0) {}
+
+void TileMap::build(const std::vector<Tile>& tiles) {
+    int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+    for (size_t i = 0; i < tiles.size(); i++) {
+        if (layerOf(tiles[i].type) == 0)
+            continue;
+        minX = std::min(minX, tiles[i].x);
+        minY = std::min(minY, tiles[i].y);
+        maxX = std::max(maxX, tiles[i].x);
+        maxY = std::max(maxY, tiles[i].y);
+    }
+
+    if (minX > maxX) {
+        reset(glm::ivec2(0), 0, 0);
+        return;
+    }
+
+    reset(glm::ivec2(minX, minY),
+        (maxX - minX) / TILE_CHUNK_SIZE + 1, (maxY - minY) / TILE_CHUNK_SIZE + 1);
+    for (size_t i = 0; i < chunks.size(); i++)
+        chunks[i].assign(TILE_CHUNK_SIZE * TILE_CHUNK_SIZE, 0);
+
+    for (size_t i = 0; i < tiles.size(); i++) {
+        unsigned char layer = layerOf(tiles[i].type);
+        if (layer == 0)
+            continue;
+        int x = tiles[i].x - originX, y = tiles[i].y - originY;
+        std::vector<unsigned char>& chunk =
+            *chunkAt(x / TILE_CHUNK_SIZE, y / TILE_CHUNK_SIZE);
+        chunk[(y % TILE_CHUNK_SIZE) * TILE_CHUNK_SIZE + x % TILE_CHUNK_SIZE] |= layer;
+    }
+}
+
+void TileMap::reset(const glm::ivec2& origin, int chunksX, int chunksY) {
+    originX = origin.x;
+    originY = origin.y;
+    chunkColumns = chunksX;
+    chunkRows = chunksY;
+    chunks.clear();
+    chunks.resize(static_cast<size_t>(chunksX) * chunksY);
+}
+
+void TileMap::setChunk(int chunkX, int chunkY, const unsigned char* layers) {
+    std::vector<unsigned char>* chunk = chunkAt(chunkX, chunkY);
+    if (chunk)
+        chunk->assign(layers, layers + TILE_CHUNK_SIZE * TILE_CHUNK_SIZE);
+}
+
+void TileMap::clearChunk(int chunkX, int chunkY) {
+    std::vector<unsigned char>* chunk = chunkAt(chunkX, chunkY);
+    if (chunk)
+        std::vector<unsigned char>().swap(*chunk);
+}
+
+bool TileMap::hasChunk(int chunkX, int chunkY) const {
+    if (chunkX < 0 || chunkY < 0 || chunkX >= chunkColumns || chunkY >= chunkRows)
+        return false;
+    return !chunks[static_cast<size_t>(chunkY) * chunkColumns + chunkX].empty();
+}
+
+std::vector<unsigned char>* TileMap::chunkAt(int chunkX, int chunkY) {
+    if (chunkX < 0 || chunkY < 0 || chunkX >= chunkColumns || chunkY >= chunkRows)
+        return nullptr;
+    return &chunks[static_cast<size_t>(chunkY) * chunkColumns + chunkX];
+}
+
+unsigned char TileMap::layersAt(int x, int y) const {
+    x -= originX;
+    y -= originY;
+    if (x < 0 || y < 0 || x >= chunkColumns * TILE_CHUNK_SIZE ||
+        y >= chunkRows * TILE_CHUNK_SIZE)
+        return 0;
+    const std::vector<unsigned char>& chunk = chunks[
+        static_cast<size_t>(y / TILE_CHUNK_SIZE) * chunkColumns + x / TILE_CHUNK_SIZE];
+    if (chunk.empty())
+        return 0;
+    return chunk[(y % TILE_CHUNK_SIZE) * TILE_CHUNK_SIZE + x % TILE_CHUNK_SIZE];
+}
+
+bool TileMap::contains(int x, int y) const {
+    x -= originX;
+    y -= originY;
+    return x >= 0 && y >= 0 && x < chunkColumns * TILE_CHUNK_SIZE &&
+        y < chunkRows * TILE_CHUNK_SIZE;
+}
+
+bool TileMap::resident(int x, int y) const {
+    if (!contains(x, y))
+        return false;
+    x -= originX;
+    y -= originY;
+    return hasChunk(x / TILE_CHUNK_SIZE, y / TILE_CHUNK_SIZE);
+}
+
+// cell c spans (c - 0.5, c + 0.5), so it strictly overlaps [min, max] for
+// min - 0.5 < c < max + 0.5
+// ------------------------------------------------------------------------
+bool TileMap::firstOverlap(const glm::vec2& min, const glm::vec2& max,
+    unsigned char layers, int& cellX, int& cellY) const {
+    int xFirst = static_cast<int>(std::floor(min.x - 0.5f)) + 1;
+    int xLast = static_cast<int>(std::ceil(max.x + 0.5f)) - 1;
+    int yFirst = static_cast<int>(std::floor(min.y - 0.5f)) + 1;
+    int yLast = static_cast<int>(std::ceil(max.y + 0.5f)) - 1;
+
+    for (int y = yFirst; y <= yLast; y++) {
+        for (int x = xFirst; x <= xLast; x++) {
+            if (layersAt(x, y) & layers) {
+                cellX = x;
+                cellY = y;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// the Minkowski sum of a cell and the box is the cell widened by the box's
+// half extents, so each cell is a ray against an AABB test: the box enters
+// when the later of its two axes enters, on that axis' face
+// ------------------------------------------------------------------------
+Tile_Sweep TileMap::sweep(const glm::vec2& center, const glm::vec2& half,
+    const glm::vec2& delta, unsigned char layers) const {
+    glm::vec2 sweptMin = glm::min(center, center + delta) - half;
+    glm::vec2 sweptMax = glm::max(center, center + delta) + half;
+    int xFirst = static_cast<int>(std::floor(sweptMin.x - 0.5f)) + 1;
+    int xLast = static_cast<int>(std::ceil(sweptMax.x + 0.5f)) - 1;
+    int yFirst = static_cast<int>(std::floor(sweptMin.y - 0.5f)) + 1;
+    int yLast = static_cast<int>(std::ceil(sweptMax.y + 0.5f)) - 1;
+
+    Tile_Sweep hit = { 1.0f, glm::ivec2(0), glm::vec2(0.0f), false };
+    glm::vec2 reach = half + 0.5f;
+    bool moving = delta.x != 0.0f || delta.y != 0.0f;
+    float slack = SWEEP_SKIN / std::max(std::abs(delta.x), std::abs(delta.y));
+    for (int y = yFirst; y <= yLast; y++) {
+        for (int x = xFirst; x <= xLast; x++) {
+            if (!(layersAt(x, y) & layers))
+                continue;
+            glm::vec2 offset = center - glm::vec2(static_cast<float>(x), static_cast<float>(y));
+            if (std::abs(offset.x) < reach.x - SWEEP_SKIN &&
+                std::abs(offset.y) < reach.y - SWEEP_SKIN) {
+                hit.overlapping = true;
+                continue;
+            }
+            if (!moving)
+                continue;
+
+            float entryX, exitX, entryY, exitY;
+            slab(center.x, delta.x, x - reach.x, x + reach.x, entryX, exitX);
+            slab(center.y, delta.y, y - reach.y, y + reach.y, entryY, exitY);
+            float entry = std::max(entryX, entryY);
+            float exit = std::min(exitX, exitY);
+            // faces the box rests against enter a hair below zero
+            if (entry >= exit || entry > hit.time || exit <= 0.0f || entry < -slack)
+                continue;
+            hit.time = std::max(entry, 0.0f);
+            hit.cell = glm::ivec2(x, y);
+            hit.normal = entryX > entryY ? glm::vec2(delta.x > 0.0f ? -1.0f : 1.0f, 0.0f) :
+                glm::vec2(0.0f, delta.y > 0.0f ? -1.0f : 1.0f);
+        }
+    }
+    return hit;
+}
+
+unsigned char TileMap::layerOf(Block_Type type) {
+    switch (type) {
+    case STONE:
+    case FINISH:
+        return SOLID_LAYER;
+    case LAVA:
+        return LAVA_LAYER;
+    case ICE:
+        return ICE_LAYER;
+    default:
+        return 0;
+    }
+}
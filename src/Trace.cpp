@@ -0,0 +1,43 @@
+#include <Trace.hpp>
+
+#include <fstream>
+#include <iostream>
+
+TraceRing::TraceRing(size_t capacity) : head(0), active(false) {
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    events.resize(size);
+    mask = size - 1;
+}
+
+size_t TraceRing::size() const {
+    unsigned long long written = head.load(std::memory_order_acquire);
+    return written < events.size() ? static_cast<size_t>(written) : events.size();
+}
+
+bool TraceRing::dump(const std::string& path) const {
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if (!file) {
+        std::cout << "ERROR::TRACE::FILE_NOT_SUCCESFULLY_WRITTEN " << path
+            << std::endl;
+        return false;
+    }
+
+    unsigned long long written = head.load(std::memory_order_acquire);
+    unsigned long long count = size();
+    unsigned int version = 1;
+    unsigned int eventSize = sizeof(TraceEvent);
+
+    file.write("ICYTRACE", 8);
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file.write(reinterpret_cast<const char*>(&eventSize), sizeof(eventSize));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    // oldest retained event first
+    for (unsigned long long i = written - count; i < written; i++)
+        file.write(reinterpret_cast<const char*>(&events[i & mask]),
+            sizeof(TraceEvent));
+
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,30 @@
+#include <UniformBuffer.hpp>
+
+#include <Profiler.hpp>
+
+#include <iostream>
+
+UniformBuffer::UniformBuffer(GLuint binding, GLsizeiptr size) : size(size) {
+    glGenBuffers(1, &ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer() { glDeleteBuffers(1, &ID); }
+
+// respecifies the whole store, so the driver can orphan the old one instead of
+// waiting on draws that still read it
+// ------------------------------------------------------------------------
+void UniformBuffer::update(const void* data, GLsizeiptr dataSize) {
+    if (dataSize != size) {
+        std::cout << "ERROR::UNIFORM_BUFFER::SIZE_MISMATCH " << dataSize
+            << " != " << size << std::endl;
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    Profiler::count(COUNTER_UNIFORM_CALLS);
+}